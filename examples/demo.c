@@ -84,6 +84,67 @@ static void free_editor_lines(void) {
     }
 }
 
+/* Minimal C highlighter; state 1 means "inside a block comment" */
+static void add_span(tui_text_span* spans, int max_spans, int* count,
+                     int start, int len, uint32_t fg, uint8_t style) {
+    if (*count >= max_spans || len <= 0) return;
+    spans[(*count)++] = (tui_text_span){start, len, fg, TUI_COLOR_DEFAULT, style};
+}
+
+static int highlight_c(const char* line, int len, int state, tui_text_span* spans,
+                       int max_spans, int* span_count, void* userdata) {
+    static const char* keywords[] = {
+        "int", "char", "void", "return", "if", "else", "for", "while",
+        "static", "const", "struct", "float", "bool", "switch", "case", NULL
+    };
+    (void)userdata;
+    *span_count = 0;
+    int i = 0;
+
+    while (i < len) {
+        int start = i;
+        char c = line[i];
+        if (state == 1) {
+            while (i < len && !(line[i] == '*' && i + 1 < len && line[i + 1] == '/')) i++;
+            if (i < len) { i += 2; state = 0; }
+            add_span(spans, max_spans, span_count, start, i - start, TUI_RGB(0x80, 0x80, 0x80), TUI_STYLE_ITALIC);
+        } else if (c == '/' && i + 1 < len && line[i + 1] == '*') {
+            state = 1;
+            i += 2;
+            while (i < len && !(line[i] == '*' && i + 1 < len && line[i + 1] == '/')) i++;
+            if (i < len) { i += 2; state = 0; }
+            add_span(spans, max_spans, span_count, start, i - start, TUI_RGB(0x80, 0x80, 0x80), TUI_STYLE_ITALIC);
+        } else if (c == '/' && i + 1 < len && line[i + 1] == '/') {
+            add_span(spans, max_spans, span_count, start, len - start, TUI_RGB(0x80, 0x80, 0x80), TUI_STYLE_ITALIC);
+            i = len;
+        } else if (c == '#' && start == 0) {
+            add_span(spans, max_spans, span_count, start, len, TUI_COLOR_MAGENTA, TUI_STYLE_NONE);
+            i = len;
+        } else if (c == '"' || c == '\'') {
+            i++;
+            while (i < len && line[i] != c) i += (line[i] == '\\') ? 2 : 1;
+            if (i < len) i++;
+            if (i > len) i = len;
+            add_span(spans, max_spans, span_count, start, i - start, TUI_COLOR_GREEN, TUI_STYLE_NONE);
+        } else if (c >= '0' && c <= '9') {
+            while (i < len && ((line[i] >= '0' && line[i] <= '9') || line[i] == '.' || line[i] == 'x')) i++;
+            add_span(spans, max_spans, span_count, start, i - start, TUI_COLOR_CYAN, TUI_STYLE_NONE);
+        } else if (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            while (i < len && (line[i] == '_' || (line[i] >= 'a' && line[i] <= 'z') ||
+                               (line[i] >= 'A' && line[i] <= 'Z') || (line[i] >= '0' && line[i] <= '9'))) i++;
+            for (int k = 0; keywords[k]; k++) {
+                if ((int)strlen(keywords[k]) == i - start && strncmp(line + start, keywords[k], i - start) == 0) {
+                    add_span(spans, max_spans, span_count, start, i - start, TUI_COLOR_YELLOW, TUI_STYLE_BOLD);
+                    break;
+                }
+            }
+        } else {
+            i++;
+        }
+    }
+    return state;
+}
+
 /* List items */
 static const char* g_list_items[] = {
     "Apple", "Banana", "Cherry", "Date", "Elderberry",
@@ -361,6 +422,7 @@ static tui_widget* create_text_panel(tui_widget* parent, int w, int h, int* tab_
     textarea->state.textarea.cursor_col = 0;
     textarea->state.textarea.line_numbers = true;
     textarea->state.textarea.editable = true;  /* Enable editing! */
+    tui_textarea_set_highlighter(textarea, highlight_c, NULL);
     textarea->tab_index = (*tab_idx)++;
     textarea->name = "editor";
     tui_widget_add_child(splitter, textarea);
@@ -382,6 +444,7 @@ static tui_widget* create_text_panel(tui_widget* parent, int w, int h, int* tab_
         "Delete: Delete right",
         "Enter: New line",
         "Tab: Insert 4 spaces",
+        "Ctrl+Z/Ctrl+Y: Undo/Redo",
         "",
         "Arrows: Move cursor",
         "Ctrl+Home: Top",
@@ -391,7 +454,7 @@ static tui_widget* create_text_panel(tui_widget* parent, int w, int h, int* tab_
         "Drag splitter to resize"
     };
     
-    for (int i = 0; i < 12; i++) {
+    for (int i = 0; i < 13; i++) {
         lbl = tui_widget_create(TUI_WIDGET_LABEL);
         tui_widget_set_bounds(lbl, 1, 2 + i, 24, 1);
         lbl->state.label.text = help_lines[i];
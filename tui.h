@@ -8,6 +8,13 @@
  *   #define TUI_IMPLEMENTATION
  *   #include "tui.h"
  *
+ * Subsystems can be compiled out, along with their struct fields, by
+ * defining any of these before every include of this header:
+ *   TUI_NO_WIDGETS    Widget tree and manager (implies TUI_NO_TEXTAREA)
+ *   TUI_NO_TEXTAREA   Multi-line editor widget and its edit/highlight/wrap caches
+ *   TUI_NO_MOUSE      Mouse reporting, mouse events and mouse input in widgets
+ *   TUI_NO_THEMES     Built-in themes other than TUI_THEME_DEFAULT
+ *
  * License: Public Domain / MIT (choose one)
  */
 
@@ -16,6 +23,18 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#if defined(TUI_NO_WIDGETS) && !defined(TUI_NO_TEXTAREA)
+    #define TUI_NO_TEXTAREA
+#endif
+
+/* Lets GCC and Clang check printf-style calls against their arguments */
+#ifdef __GNUC__
+    #define TUI_PRINTF_LIKE(fmt_index, first_arg) __attribute__((format(printf, fmt_index, first_arg)))
+#else
+    #define TUI_PRINTF_LIKE(fmt_index, first_arg)
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -31,6 +50,7 @@ typedef struct {
     uint32_t bg;
     uint32_t underline_color;  /* For colored underlines/undercurl */
     uint8_t  style;
+    uint16_t link;             /* Interned hyperlink ID (0 = none) */
 } tui_cell;
 
 typedef enum {
@@ -68,7 +88,9 @@ typedef enum {
 typedef enum {
     TUI_EVENT_NONE,
     TUI_EVENT_KEY,
+#ifndef TUI_NO_MOUSE
     TUI_EVENT_MOUSE,
+#endif
     TUI_EVENT_RESIZE,
     TUI_EVENT_PASTE_START,   /* Bracketed paste begin */
     TUI_EVENT_PASTE_END,     /* Bracketed paste end */
@@ -76,6 +98,7 @@ typedef enum {
     TUI_EVENT_FOCUS_OUT      /* Terminal lost focus */
 } tui_event_type;
 
+#ifndef TUI_NO_MOUSE
 typedef enum {
     TUI_MOUSE_NONE,
     TUI_MOUSE_LEFT,
@@ -86,14 +109,18 @@ typedef enum {
     TUI_MOUSE_WHEEL_DOWN,
     TUI_MOUSE_MOVE
 } tui_mouse_button;
+#endif
 
 typedef struct {
     tui_event_type type;
     tui_key key;
     uint32_t ch;
+#ifndef TUI_NO_MOUSE
     tui_mouse_button mouse_button;
     int mouse_x;
     int mouse_y;
+    bool mouse_drag;    /* Motion with mouse_button held, not a new press */
+#endif
     int new_width;
     int new_height;
     bool ctrl;      /* Ctrl modifier held */
@@ -157,8 +184,34 @@ void tui_set_fg(tui_context* ctx, uint32_t color);
 void tui_set_bg(tui_context* ctx, uint32_t color);
 void tui_set_style(tui_context* ctx, uint8_t style);
 
+/* Complete drawing state as one value. Pushing applies it in one step and
+ * saves the previous state for the matching pop, replacing hand-written
+ * save/restore of each field. The stack is emptied by tui_begin_frame;
+ * pushes nested deeper than TUI_STYLE_STACK_DEPTH apply but do not restore. */
+typedef struct {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t underline_color;
+    uint8_t attrs;              /* TUI_STYLE_* bits */
+} tui_style;
+
+tui_style tui_style_make(uint32_t fg, uint32_t bg, uint8_t attrs);
+tui_style tui_get_current_style(tui_context* ctx);
+void tui_apply_style(tui_context* ctx, tui_style style);
+void tui_push_style(tui_context* ctx, tui_style style);
+void tui_pop_style(tui_context* ctx);
+
+/* Clip rectangle for all drawing (reset to the screen every frame) */
+void tui_set_clip(tui_context* ctx, int x, int y, int w, int h);
+void tui_reset_clip(tui_context* ctx);
+
 void tui_set_cell(tui_context* ctx, int x, int y, uint32_t codepoint);
 void tui_label(tui_context* ctx, int x, int y, const char* text);
+/* printf-style label drawn straight into cells, without a buffer. Supports
+ * %d %i %u %x %X %c %s %f %e %g %% with - 0 + space flags, width, precision
+ * (both may be *) and h/l/ll/z sizes. Widths count cells, not bytes. From
+ * any other conversion on, the format is drawn as written. */
+void tui_labelf(tui_context* ctx, int x, int y, const char* fmt, ...) TUI_PRINTF_LIKE(4, 5);
 int  tui_button(tui_context* ctx, int x, int y, const char* text);
 
 int tui_poll_event(tui_context* ctx, tui_event* event);
@@ -166,8 +219,10 @@ int tui_poll_event(tui_context* ctx, tui_event* event);
 void tui_set_cursor(tui_context* ctx, int x, int y);
 void tui_show_cursor(tui_context* ctx, bool show);
 
+#ifndef TUI_NO_MOUSE
 void tui_enable_mouse(tui_context* ctx);
 void tui_disable_mouse(tui_context* ctx);
+#endif
 
 bool tui_resized(tui_context* ctx);
 void tui_clear(tui_context* ctx);
@@ -192,12 +247,28 @@ void tui_disable_focus_events(tui_context* ctx);
 void tui_begin_sync(tui_context* ctx);
 void tui_end_sync(tui_context* ctx);
 
-/* Clipboard (OSC 52) */
-void tui_clipboard_set(tui_context* ctx, const char* text);
-
-/* Hyperlinks (OSC 8) */
+/* Clipboard (OSC 52). Text is base64-encoded straight into the output
+ * buffer; streams declare their length up front so the terminal limit is
+ * checked before anything is sent. */
+typedef enum {
+    TUI_CLIPBOARD_OK,
+    TUI_CLIPBOARD_TOO_LARGE,    /* Encoded size over the limit; nothing sent */
+    TUI_CLIPBOARD_BAD_STATE,    /* No stream open, one already open, or length mismatch */
+    TUI_CLIPBOARD_INVALID       /* NULL context or data */
+} tui_clipboard_status;
+
+tui_clipboard_status tui_clipboard_set(tui_context* ctx, const char* text);
+tui_clipboard_status tui_clipboard_set_bytes(tui_context* ctx, const char* data, size_t len);
+void tui_clipboard_set_limit(tui_context* ctx, size_t max_encoded);  /* 0 = unlimited */
+tui_clipboard_status tui_clipboard_begin(tui_context* ctx, size_t total_len);
+tui_clipboard_status tui_clipboard_write(tui_context* ctx, const char* data, size_t len);
+tui_clipboard_status tui_clipboard_end(tui_context* ctx);  /* Error if fewer bytes than declared */
+
+/* Hyperlinks (OSC 8): cells drawn in between carry the link; the renderer
+ * opens and closes it as the link changes between emitted cells */
 void tui_hyperlink_start(tui_context* ctx, const char* url);
 void tui_hyperlink_end(tui_context* ctx);
+void tui_hyperlink_reset(tui_context* ctx);  /* Forget interned URLs (forces a full redraw) */
 
 /* Wide character support */
 int tui_char_width(uint32_t codepoint);  /* Returns 0, 1, or 2 */
@@ -229,12 +300,76 @@ typedef enum {
 void tui_label_aligned(tui_context* ctx, int x, int y, int width, const char* text, tui_align align);
 int tui_text_width(const char* text);
 
+/* Interned strings: each distinct text is stored once with its byte
+ * length, display width and a printable-ASCII flag, and referenced by a
+ * handle. Texts stay valid until the table is destroyed. Widgets with a
+ * handle field (label text_id, list/dropdown item_ids) resolve it through
+ * the table set on the context, skipping strlen and width measuring. */
+typedef struct tui_strings tui_strings;
+typedef uint32_t tui_str;       /* 0 = no string */
+
+tui_strings* tui_strings_create(void);
+void tui_strings_destroy(tui_strings* table);
+tui_str tui_str_intern(tui_strings* table, const char* text);
+tui_str tui_str_intern_n(tui_strings* table, const char* text, int len);
+const char* tui_str_text(const tui_strings* table, tui_str s);  /* "" if unknown */
+int tui_str_len(const tui_strings* table, tui_str s);    /* Bytes */
+int tui_str_width(const tui_strings* table, tui_str s);  /* Cells */
+bool tui_str_is_ascii(const tui_strings* table, tui_str s);  /* Printable ASCII only */
+void tui_set_strings(tui_context* ctx, tui_strings* table);  /* Not owned */
+void tui_label_str(tui_context* ctx, int x, int y, tui_str s);
+
 /* Text wrapping */
 int tui_wrap_text(tui_context* ctx, int x, int y, int width, int max_lines, const char* text);
 
 /* Modal/Popup helpers */
 void tui_popup_box(tui_context* ctx, int x, int y, int w, int h, const char* title, tui_border_style style);
 
+/* Save-under: snapshot the cells an overlay will cover and put them back
+ * when it closes or moves, instead of redrawing everything beneath it.
+ * tui_begin_frame drops all snapshots (the tree is redrawn anyway); with
+ * tui_begin_frame_retained last frame's cells and the snapshots survive.
+ * tui_wm_draw does this for its overlay layer. */
+void tui_begin_frame_retained(tui_context* ctx);
+int  tui_save_under(tui_context* ctx, int x, int y, int w, int h);  /* Snapshot id, -1 if none */
+bool tui_restore_under(tui_context* ctx, int id);  /* Releases id; false: stale, redraw beneath */
+void tui_discard_under(tui_context* ctx, int id);
+void tui_invalidate_under(tui_context* ctx, int x, int y, int w, int h);  /* Content beneath changed */
+
+/* Pixel canvas: 2x4 Braille dots or 1x2 half blocks per cell */
+typedef enum {
+    TUI_CANVAS_BRAILLE,         /* Monochrome dots, one color per cell */
+    TUI_CANVAS_HALFBLOCK        /* Colored pixels, two per cell */
+} tui_canvas_mode;
+
+typedef struct tui_canvas tui_canvas;
+
+tui_canvas* tui_canvas_create(int cols, int rows, tui_canvas_mode mode);  /* Size in cells */
+void tui_canvas_destroy(tui_canvas* canvas);
+bool tui_canvas_resize(tui_canvas* canvas, int cols, int rows);  /* Clears the canvas */
+int tui_canvas_width(const tui_canvas* canvas);   /* In pixels */
+int tui_canvas_height(const tui_canvas* canvas);
+void tui_canvas_clear(tui_canvas* canvas);
+void tui_canvas_set_color(tui_canvas* canvas, uint32_t color);  /* Pen for following drawing */
+void tui_canvas_set_bg(tui_canvas* canvas, uint32_t color);
+void tui_canvas_set(tui_canvas* canvas, int x, int y, bool on);
+bool tui_canvas_get(const tui_canvas* canvas, int x, int y);
+void tui_canvas_line(tui_canvas* canvas, int x0, int y0, int x1, int y1);
+void tui_canvas_rect(tui_canvas* canvas, int x, int y, int w, int h, bool filled);
+void tui_canvas_polyline(tui_canvas* canvas, const int* points, int count);  /* count x,y pairs */
+void tui_canvas_draw(tui_context* ctx, tui_canvas* canvas, int x, int y);
+
+/* Append-only numeric series with cached min/max levels (for charts) */
+typedef struct tui_series tui_series;
+
+tui_series* tui_series_create(void);
+void tui_series_destroy(tui_series* s);
+bool tui_series_push(tui_series* s, float value);  /* Amortized O(1) */
+void tui_series_clear(tui_series* s);
+int tui_series_count(const tui_series* s);
+float tui_series_get(const tui_series* s, int index);
+bool tui_series_range(const tui_series* s, int start, int end, float* min, float* max);  /* [start, end) */
+
 /* ============================================================================
  * Theming System
  * ============================================================================ */
@@ -272,25 +407,95 @@ typedef struct {
 
 /* Built-in themes */
 extern const tui_theme TUI_THEME_DEFAULT;
+#ifndef TUI_NO_THEMES
 extern const tui_theme TUI_THEME_DARK;
 extern const tui_theme TUI_THEME_LIGHT;
 extern const tui_theme TUI_THEME_BLUE;
 extern const tui_theme TUI_THEME_GREEN;
+#endif
 
 void tui_set_theme(tui_context* ctx, const tui_theme* theme);
 const tui_theme* tui_get_theme(tui_context* ctx);
 
+/* Style tokens: the theme resolved into one ready-made style per widget
+ * state. tui_set_theme recomputes them, so drawing only looks them up.
+ * Glyph tokens (toggle focus, track, fill, thumb, separator, divider) are
+ * drawn with their fg over the widget's own background. */
+typedef enum {
+    TUI_TOKEN_TEXT,                 /* Labels, panels, list rows, textarea */
+    TUI_TOKEN_DISABLED,
+    TUI_TOKEN_BUTTON,
+    TUI_TOKEN_BUTTON_FOCUSED,
+    TUI_TOKEN_BUTTON_PRESSED,
+    TUI_TOKEN_TOGGLE_FOCUSED,       /* Checkbox and radio */
+    TUI_TOKEN_INPUT,                /* Textbox, spinner value */
+    TUI_TOKEN_INPUT_FOCUSED,
+    TUI_TOKEN_CURSOR,
+    TUI_TOKEN_SELECTION,
+    TUI_TOKEN_LIST_CURRENT,
+    TUI_TOKEN_LIST_CURRENT_BLURRED,
+    TUI_TOKEN_TAB,
+    TUI_TOKEN_TAB_ACTIVE,
+    TUI_TOKEN_TAB_ACTIVE_BLURRED,
+    TUI_TOKEN_SEPARATOR,
+    TUI_TOKEN_DROPDOWN,
+    TUI_TOKEN_DROPDOWN_FOCUSED,
+    TUI_TOKEN_MENU,                 /* Open dropdown list */
+    TUI_TOKEN_MENU_SELECTED,
+    TUI_TOKEN_SPIN_BUTTON,
+    TUI_TOKEN_SPIN_BUTTON_FOCUSED,
+    TUI_TOKEN_TRACK,                /* Progress, slider and scrollbar */
+    TUI_TOKEN_FILL,
+    TUI_TOKEN_THUMB,
+    TUI_TOKEN_THUMB_FOCUSED,
+    TUI_TOKEN_DIVIDER,              /* Splitter */
+    TUI_TOKEN_DIVIDER_ACTIVE,
+    TUI_TOKEN_GUTTER,               /* Textarea line numbers */
+    TUI_TOKEN_GUTTER_EMPTY,
+    TUI_TOKEN_POPUP,
+    TUI_TOKEN_POPUP_TITLE,
+    TUI_TOKEN_COUNT
+} tui_style_token;
+
+tui_style tui_theme_token(tui_context* ctx, tui_style_token token);
+void tui_push_token(tui_context* ctx, tui_style_token token);
+
 /* Animation helpers */
 uint32_t tui_lerp_color(uint32_t from, uint32_t to, float t);
 float tui_ease_in_out(float t);
 
+/* Region transforms: blend cells already in the back buffer, e.g. to dim
+ * what is behind a popup or to fade a panel without redrawing it */
+typedef enum {
+    TUI_TRANSFORM_FADE,         /* fg and bg toward the target color */
+    TUI_TRANSFORM_FG,           /* fg (and underline color) only */
+    TUI_TRANSFORM_BG,           /* bg only */
+    TUI_TRANSFORM_DESATURATE    /* fg and bg toward their own gray; target unused */
+} tui_transform_op;
+
+void tui_region_transform(tui_context* ctx, int x, int y, int w, int h,
+                          tui_transform_op op, uint32_t target, float amount);  /* amount 0..1 */
+
 /* ============================================================================
  * HIERARCHICAL WIDGET SYSTEM
  * ============================================================================ */
 
+#ifndef TUI_NO_WIDGETS
+
 /* Forward declarations */
 typedef struct tui_widget tui_widget;
 typedef struct tui_widget_event tui_widget_event;
+typedef struct tui_widget_manager tui_widget_manager;
+#ifndef TUI_NO_TEXTAREA
+typedef struct tui_undo_log tui_undo_log;
+typedef struct tui_highlight_cache tui_highlight_cache;
+typedef struct tui_wrap_index tui_wrap_index;
+typedef struct tui_line_cache tui_line_cache;
+#endif
+typedef struct tui_sample_ring tui_sample_ring;
+typedef struct tui_image_cache tui_image_cache;
+typedef struct tui_value tui_value;
+typedef struct tui_step_state tui_step_state;
 
 /* Widget types */
 typedef enum {
@@ -299,7 +504,9 @@ typedef enum {
     TUI_WIDGET_LABEL,       /* Static text */
     TUI_WIDGET_BUTTON,      /* Clickable button */
     TUI_WIDGET_TEXTBOX,     /* Single-line text input */
+#ifndef TUI_NO_TEXTAREA
     TUI_WIDGET_TEXTAREA,    /* Multi-line text editor */
+#endif
     TUI_WIDGET_CHECKBOX,    /* Toggle checkbox */
     TUI_WIDGET_RADIO,       /* Radio button (exclusive selection) */
     TUI_WIDGET_LIST,        /* Scrollable list */
@@ -310,9 +517,30 @@ typedef enum {
     TUI_WIDGET_TABS,        /* Tab bar */
     TUI_WIDGET_SCROLLBAR,   /* Scrollbar */
     TUI_WIDGET_SPLITTER,    /* Resizable split pane */
+    TUI_WIDGET_CHART,       /* Line/area chart of a tui_series */
+    TUI_WIDGET_SPARKLINE,   /* One-cell-wide bars of recent samples */
+    TUI_WIDGET_BARS,        /* Bar chart / histogram of recent samples */
+    TUI_WIDGET_HEATMAP,     /* Matrix of values mapped onto a color ramp */
+    TUI_WIDGET_IMAGE,       /* RGB pixels as half-block cells */
+    TUI_WIDGET_SCROLLVIEW,  /* Scrolls its children over a larger canvas */
     TUI_WIDGET_CUSTOM       /* User-defined widget */
 } tui_widget_type;
 
+/* Image dithering onto the xterm 6x6x6 color cube */
+typedef enum {
+    TUI_DITHER_NONE,            /* Exact (averaged) colors */
+    TUI_DITHER_ORDERED,         /* 4x4 Bayer matrix, stable between frames */
+    TUI_DITHER_FLOYD_STEINBERG  /* Error diffusion */
+} tui_dither_mode;
+
+/* Observable value cells (see tui_widget_bind) */
+typedef enum {
+    TUI_VALUE_INT,
+    TUI_VALUE_FLOAT,
+    TUI_VALUE_STRING,
+    TUI_VALUE_LIST              /* Strings, e.g. list or tab items */
+} tui_value_type;
+
 /* Event phases for bubbling */
 typedef enum {
     TUI_PHASE_CAPTURE,      /* Going down the tree (parent → child) */
@@ -337,6 +565,27 @@ typedef void (*tui_event_handler)(tui_widget* widget, tui_widget_event* event, v
 /* Widget draw callback (for custom widgets) */
 typedef void (*tui_widget_draw_fn)(tui_widget* widget, tui_context* ctx);
 
+/* Resumable draw: draw pass number 'pass', return true once complete */
+typedef bool (*tui_widget_step_fn)(tui_widget* widget, tui_context* ctx, int pass);
+
+#ifndef TUI_NO_TEXTAREA
+/* Styled byte range within a textarea line */
+typedef struct {
+    int start;                  /* Byte offset in the line */
+    int length;                 /* Length in bytes */
+    uint32_t fg;
+    uint32_t bg;                /* TUI_COLOR_DEFAULT keeps the widget background */
+    uint8_t style;
+} tui_text_span;
+
+/* Syntax highlighter callback: lexes one line starting in state_in, writes at
+ * most max_spans spans (sorted by start) and returns the state at line end.
+ * State 0 is the state before the first line. */
+typedef int (*tui_highlight_fn)(const char* line, int len, int state_in,
+                                tui_text_span* spans, int max_spans, int* span_count,
+                                void* userdata);
+#endif
+
 /* Maximum children per widget */
 #define TUI_MAX_CHILDREN 64
 #define TUI_MAX_HANDLERS 8
@@ -392,9 +641,21 @@ struct tui_widget {
     /* Custom draw function */
     tui_widget_draw_fn draw_fn;
     
+    /* Resumable draw (see tui_wm_draw_budgeted) */
+    tui_widget_step_fn step_fn;
+    tui_step_state* step;       /* Cells kept between passes (owned) */
+    
+    /* Manager holding this widget's overlay (closed on destroy) */
+    tui_widget_manager* overlay_wm;
+    
     /* Widget-specific data */
     void* data;
     
+    /* Data binding */
+    tui_value* binding;         /* Value shown by this widget (not owned) */
+    uint32_t binding_version;   /* Version last copied into the state */
+    bool dirty;                 /* Changed since last drawn (ancestors too) */
+    
     /* Style overrides */
     uint32_t bg_color;
     uint32_t fg_color;
@@ -403,56 +664,165 @@ struct tui_widget {
     
     /* For specific widget types */
     union {
-        struct { const char* text; tui_align align; } label;
+        struct { const char* text; tui_align align; tui_str text_id; } label;  /* text_id wins if set */
         struct { const char* text; bool pressed; } button;
         struct { char* buffer; int capacity; int length; int cursor; int scroll; } textbox;
+#ifndef TUI_NO_TEXTAREA
         struct { 
             char** lines;           /* Array of line pointers (mutable if editable) */
             int line_count;         /* Total number of lines */
             int line_capacity;      /* Allocated capacity for lines array */
             int cursor_row;         /* Cursor row (0-based) */
             int cursor_col;         /* Cursor column (0-based) */
-            int scroll_row;         /* First visible row */
+            int scroll_row;         /* First visible row (visual row when word_wrap) */
             int scroll_col;         /* Horizontal scroll offset */
-            int sel_start_row;      /* Selection start row (-1 = no selection) */
-            int sel_start_col;      /* Selection start column */
-            int sel_end_row;        /* Selection end row */
-            int sel_end_col;        /* Selection end column */
+            int sel_start_row;      /* Selection anchor row (-1 = no selection) */
+            int sel_start_col;      /* Selection anchor column */
+            int sel_end_row;        /* Selection head row (follows the cursor) */
+            int sel_end_col;        /* Selection head column */
+#ifndef TUI_NO_MOUSE
+            bool sel_dragging;      /* Mouse button held since a click in the text */
+#endif
             bool line_numbers;      /* Show line numbers gutter */
             bool word_wrap;         /* Enable word wrapping */
             bool editable;          /* Allow text editing */
             int max_line_len;       /* Max chars per line (for editable mode) */
+            tui_undo_log* undo;     /* Edit history (owned, created on first edit) */
+            tui_highlight_cache* highlight;  /* Per-line lexer cache (owned) */
+            tui_wrap_index* wrap;   /* Visual row index for word_wrap (owned) */
+            tui_line_cache* line_info;  /* Cached line lengths and widths (owned) */
         } textarea;
+#endif
         struct { const char* text; bool checked; } checkbox;
         struct { const char* text; int* group_value; int value; } radio;
-        struct { const char** items; int count; int selected; int scroll; int visible; } list;
+        struct {
+            const char** items;
+            int count;
+            int selected;
+            int scroll;
+            int visible;
+            int anchor;             /* Other end of the selected range (-1 = none) */
+            const tui_str* item_ids;  /* Interned items, used instead of items if set */
+        } list;
         struct { float value; float min; float max; } progress;
-        struct { float value; float min; float max; float step; bool dragging; } slider;
+        struct {
+            float value; float min; float max; float step;
+#ifndef TUI_NO_MOUSE
+            bool dragging;
+#endif
+        } slider;
         struct { int value; int min; int max; int step; } spinner;
-        struct { const char** items; int count; int selected; int scroll; bool open; } dropdown;
+        struct { const char** items; int count; int selected; int scroll; bool open; const tui_str* item_ids; } dropdown;
         struct { const char** labels; int count; int selected; } tabs;
-        struct { int content_size; int view_size; int scroll; bool vertical; bool dragging; int drag_start; } scrollbar;
+        struct {
+            int content_size; int view_size; int scroll; bool vertical;
+#ifndef TUI_NO_MOUSE
+            bool dragging; int drag_start;
+#endif
+        } scrollbar;
         struct {
             bool vertical;          /* Vertical or horizontal split */
             float ratio;            /* Split ratio (0.0 - 1.0) */
             int min_size;           /* Minimum size for each pane */
+#ifndef TUI_NO_MOUSE
             bool dragging;          /* User is dragging the divider */
+#endif
         } splitter;
+        struct {
+            tui_series* series;     /* Data (not owned) */
+            int window;             /* Newest points shown (0 = all) */
+            float y_min;            /* Fixed scale; auto when y_min >= y_max */
+            float y_max;
+            bool area;              /* Fill below the line */
+            tui_canvas* canvas;     /* Render target (owned) */
+            /* Inputs of the last render; the canvas is reused while they hold */
+            bool rendered;
+            const tui_series* drawn_series;
+            unsigned drawn_version;
+            int drawn_window;
+            float drawn_y_min;
+            float drawn_y_max;
+            bool drawn_area;
+            uint32_t drawn_fg;
+            uint32_t drawn_bg;
+        } chart;
+        struct {
+            tui_sample_ring* ring;  /* Samples (owned, see tui_sparkline_set_capacity) */
+            int bar_width;          /* Columns per sample */
+            int gap;                /* Columns between samples */
+            float y_min;            /* Fixed scale; running min/max when y_min >= y_max */
+            float y_max;
+        } sparkline;                /* TUI_WIDGET_SPARKLINE and TUI_WIDGET_BARS */
+        struct {
+            const float* values;    /* Row-major matrix (not owned) */
+            int cols;
+            int rows;
+            float v_min;            /* Values mapped onto the ends of the ramp */
+            float v_max;
+            bool half_block;        /* Two matrix rows per cell */
+            uint32_t* lut;          /* Sampled color ramp (owned) */
+        } heatmap;
+        struct {
+            const uint8_t* pixels;  /* RGB, 3 bytes per pixel (not owned) */
+            int img_width;
+            int img_height;
+            int stride;             /* Bytes per row (0 = img_width * 3) */
+            tui_dither_mode dither;
+            tui_image_cache* cache; /* Scaled pixels and encoded cells (owned) */
+        } image;
+        struct {
+            int content_width;      /* Canvas the children are placed on */
+            int content_height;
+            int scroll_x;           /* Canvas position at the viewport's top-left */
+            int scroll_y;
+            bool retain;            /* Reuse drawn rows; see tui_scrollview_invalidate */
+            tui_cell* cache;        /* Viewport cells of the last frame (owned) */
+            int cache_width;
+            int cache_height;
+            int cache_x;            /* Scroll position the cache was drawn at */
+            int cache_y;
+            bool cache_valid;
+        } scrollview;
     } state;
 };
 
 /* Focus stack for modals */
 #define TUI_MAX_FOCUS_STACK 16
 
+/* Overlays: drawn after the tree in z order, hit-tested before it */
+#define TUI_MAX_OVERLAYS 8
+
 typedef struct {
+    tui_widget* owner;          /* Receives input that lands on the overlay */
+    int x, y, width, height;    /* Absolute */
+    int z;                      /* Higher is on top */
+    tui_widget_draw_fn draw_fn; /* NULL: owner's built-in overlay (dropdown list) */
+    bool seen;                  /* Built-in overlay re-requested this frame */
+} tui_overlay;
+
+struct tui_widget_manager {
     tui_widget* root;           /* Root widget */
     tui_widget* focus;          /* Currently focused widget */
+#ifndef TUI_NO_MOUSE
     tui_widget* hover;          /* Widget under mouse */
+#endif
     tui_widget* focus_stack[TUI_MAX_FOCUS_STACK];  /* For modals */
     int focus_stack_top;
+    float modal_dim;            /* Dim behind the top modal, 0..1 (0 = off) */
+    tui_overlay overlays[TUI_MAX_OVERLAYS];  /* Sorted by z */
+    int overlay_count;
+    int damage_x, damage_y;     /* Area overlays opened, moved or closed in */
+    int damage_w, damage_h;     /* (0 = none) */
+    int under_ids[TUI_MAX_OVERLAYS];  /* Save-under per drawn overlay, in draw order */
+    int under_count;
+    bool under_missing;         /* An overlay drew without a snapshot (no free slot) */
+    bool drawn;                 /* Back buffer holds this tree from the last draw */
+    tui_widget* drawn_modal;    /* Modal the last full draw dimmed behind */
+    int64_t step_deadline;      /* Budgeted draw: no more passes after this (us, 0 = none) */
+    bool steps_pending;         /* A step widget did not finish in the last draw */
     tui_hotkey hotkeys[TUI_MAX_HOTKEYS];
     int hotkey_count;
-} tui_widget_manager;
+};
 
 /* Widget creation/destruction */
 tui_widget* tui_widget_create(tui_widget_type type);
@@ -499,6 +869,15 @@ void tui_wm_pop_focus(tui_widget_manager* wm);
 /* Hit testing */
 tui_widget* tui_wm_hit_test(tui_widget_manager* wm, int x, int y);
 
+/* Overlay layer (dropdown lists register themselves). Opening an owner
+ * that already has an overlay moves it. While a modal is pushed, only
+ * owners inside it can have overlays; others are closed. Destroying an
+ * owner closes its overlay, so the manager must outlive it. */
+bool tui_wm_open_overlay(tui_widget_manager* wm, tui_widget* owner, int x, int y,
+                         int width, int height, int z, tui_widget_draw_fn draw_fn);
+void tui_wm_close_overlay(tui_widget_manager* wm, tui_widget* owner);
+bool tui_wm_take_damage(tui_widget_manager* wm, int* x, int* y, int* width, int* height);
+
 /* Hotkeys */
 void tui_wm_register_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
                             bool ctrl, bool alt, bool shift,
@@ -506,6 +885,99 @@ void tui_wm_register_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
 void tui_wm_unregister_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
                               bool ctrl, bool alt, bool shift);
 
+/* Bulk insertion in a single pass ('\n' splits textarea lines). Nothing is
+ * inserted if the text does not fit; a cursor at or after pos moves along. */
+bool tui_textbox_insert(tui_widget* w, int pos, const char* bytes, int len);
+#ifndef TUI_NO_TEXTAREA
+bool tui_textarea_insert(tui_widget* w, int row, int col, const char* bytes, int len);
+
+/* Textarea edit history (Ctrl+Z / Ctrl+Y when focused) */
+bool tui_textarea_undo(tui_widget* w);
+bool tui_textarea_redo(tui_widget* w);
+void tui_textarea_set_undo_limit(tui_widget* w, int max_bytes);  /* Bytes of history kept */
+void tui_textarea_clear_undo(tui_widget* w);  /* Call after modifying lines directly */
+
+/* Textarea syntax highlighting (lines are lexed lazily as they become visible) */
+void tui_textarea_set_highlighter(tui_widget* w, tui_highlight_fn fn, void* userdata);
+void tui_textarea_invalidate_highlight(tui_widget* w, int row, int count);  /* count < 0: to end */
+
+/* Per-line lengths, display widths, highlighting and wrapping are cached.
+ * Replacing a line pointer is detected; after modifying a line in place,
+ * report it so every per-line cache is refreshed. */
+void tui_textarea_invalidate(tui_widget* w, int row, int count);  /* count < 0: to end */
+int tui_textarea_line_width(tui_widget* w, int row);  /* Display width in cells */
+#endif
+
+/* Selections are an anchor and a head (the cursor), never per-item flags.
+ * Shift+movement, mouse drags and Ctrl+A select; typing replaces the
+ * selection. Copying streams the text straight into the OSC 52 encoder. */
+#ifndef TUI_NO_TEXTAREA
+void tui_textarea_select(tui_widget* w, int anchor_row, int anchor_col, int row, int col);
+void tui_textarea_clear_selection(tui_widget* w);
+bool tui_textarea_get_selection(tui_widget* w, int* start_row, int* start_col,
+                                int* end_row, int* end_col);  /* End is exclusive */
+tui_clipboard_status tui_textarea_copy_selection(tui_context* ctx, tui_widget* w);
+#endif
+void tui_list_select_range(tui_widget* w, int anchor, int cursor);  /* anchor < 0: single row */
+int tui_list_get_selection(tui_widget* w, int* first, int* last);  /* Returns the row count */
+tui_clipboard_status tui_list_copy_selection(tui_context* ctx, tui_widget* w);  /* One item per line */
+
+/* Sparkline / bars samples: a ring allocated once, O(1) push */
+bool tui_sparkline_set_capacity(tui_widget* w, int capacity);  /* Discards samples */
+void tui_sparkline_push(tui_widget* w, float value);
+void tui_sparkline_clear(tui_widget* w);
+
+/* Heatmap color ramp: evenly spaced stops (NULL = default blue..red) */
+void tui_heatmap_set_ramp(tui_widget* w, const uint32_t* colors, int count);
+
+/* Scroll view: children use canvas coordinates. A retaining view reuses its
+ * last frame, so call tui_scrollview_invalidate after changing a child
+ * (input routed by the manager and focus changes do this already). */
+void tui_scrollview_scroll_to(tui_widget* w, int x, int y);  /* Clamped to the canvas */
+void tui_scrollview_invalidate(tui_widget* w);
+
+/* Observable values. Writes that change a value bump its version and mark
+ * bound widgets and their ancestors dirty; widgets pick up the value when
+ * drawn, and input on a bound slider, spinner or checkbox writes back. */
+tui_value* tui_value_create_int(int value);
+tui_value* tui_value_create_float(float value);
+tui_value* tui_value_create_string(const char* value);  /* Copied */
+tui_value* tui_value_create_list(void);
+void tui_value_destroy(tui_value* v);  /* Unbinds its widgets */
+uint32_t tui_value_version(const tui_value* v);
+void tui_value_set_int(tui_value* v, int value);
+void tui_value_set_float(tui_value* v, float value);
+bool tui_value_set_string(tui_value* v, const char* value);
+int tui_value_get_int(const tui_value* v);
+float tui_value_get_float(const tui_value* v);
+const char* tui_value_get_string(const tui_value* v);
+bool tui_value_list_insert(tui_value* v, int index, const char* item);  /* index < 0: append */
+bool tui_value_list_set(tui_value* v, int index, const char* item);
+void tui_value_list_remove(tui_value* v, int index);
+void tui_value_list_clear(tui_value* v);
+int tui_value_list_count(const tui_value* v);
+const char* tui_value_list_get(const tui_value* v, int index);
+
+/* Label/button: STRING; progress/slider/spinner/checkbox: INT or FLOAT;
+ * list/dropdown/tabs: LIST. NULL unbinds. */
+bool tui_widget_bind(tui_widget* w, tui_value* v);
+void tui_widget_unbind(tui_widget* w);
+void tui_widget_invalidate(tui_widget* w);  /* After changing a widget's state directly */
+bool tui_wm_is_dirty(tui_widget_manager* wm);  /* Anything to draw since the last tui_wm_draw */
+
+/* Progressive drawing: a widget with a step function keeps its cells and
+ * runs passes until the budget of tui_wm_draw_budgeted runs out (at least
+ * one per frame), showing what it has so far; tui_wm_draw runs them all.
+ * Returns true when no widget is left unfinished. */
+void tui_widget_set_step(tui_widget* w, tui_widget_step_fn step);
+bool tui_wm_draw_budgeted(tui_widget_manager* wm, tui_context* ctx, int budget_us);
+
+/* Image: call after changing the pixels in place (a new pointer or size is
+ * picked up automatically); only cells whose pixels changed are re-encoded */
+void tui_image_invalidate(tui_widget* w);
+
+#endif /* TUI_NO_WIDGETS */
+
 #ifdef __cplusplus
 }
 #endif
@@ -521,6 +993,8 @@ void tui_wm_unregister_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
 
 /* ============================================================================
  * Platform Detection
@@ -547,6 +1021,11 @@ void tui_wm_unregister_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
     #include <errno.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TUI_SIMD_SSE2 1
+    #include <emmintrin.h>
+#endif
+
 /* ============================================================================
  * Constants
  * ============================================================================ */
@@ -555,11 +1034,39 @@ void tui_wm_unregister_hotkey(tui_widget_manager* wm, tui_key key, uint32_t ch,
 #define TUI_MAX_HEIGHT 256
 #define TUI_INPUT_BUFFER_SIZE 64
 #define TUI_OUTPUT_BUFFER_SIZE 65536
+#define TUI_UNDO_DEFAULT_LIMIT (16 * 1024 * 1024)  /* Textarea history budget in bytes */
+#define TUI_UNDO_COALESCE_MAX  64                  /* Longest keystroke run merged into one step */
+#define TUI_HIGHLIGHT_MAX_SPANS 64                 /* Spans a highlighter may emit per line */
+#define TUI_HIGHLIGHT_LOOKAHEAD 16                 /* Lines lexed past the bottom of the view */
+#define TUI_SERIES_FANOUT      8                   /* Values summarized per min/max entry */
+#define TUI_SERIES_MAX_LEVELS  10                  /* Summary levels (FANOUT^10 values) */
+#define TUI_HEATMAP_LUT_SIZE   256                 /* Colors sampled from a heatmap ramp */
+#define TUI_HEATMAP_BLOCK      16                  /* Values quantized per fixed-size block */
+#define TUI_SAVE_UNDER_SLOTS   8                   /* Overlays that can hold a snapshot at once */
+#define TUI_MAX_LINKS          0xFFFF              /* Interned hyperlink URLs (IDs are uint16) */
+#define TUI_CLIPBOARD_DEFAULT_LIMIT 65536          /* Encoded OSC 52 payload most terminals accept */
+#define TUI_STRINGS_BLOCK_SIZE 16384               /* Text storage per interned-string block */
+#define TUI_STYLE_STACK_DEPTH  32                  /* Nested tui_push_style calls restored */
+
+/* Cell features a frame uses; selects the tui_end_frame kernel */
+#define TUI_RENDER_STYLE       0x1                 /* Some cell has style attributes */
+#define TUI_RENDER_UNDERLINE   0x2                 /* Some cell has an underline color */
+#define TUI_RENDER_LINK        0x4                 /* Some cell carries a hyperlink ID */
+#define TUI_RENDER_VARIANTS    8
 
 /* ============================================================================
  * Internal Structures
  * ============================================================================ */
 
+/* Pooled save-under snapshot; cells are kept for reuse after release */
+typedef struct {
+    tui_cell* cells;
+    int capacity;
+    int x, y, w, h;
+    bool used;
+    bool valid;
+} tui_save_slot;
+
 struct tui_context {
     /* Terminal dimensions */
     int width;
@@ -573,6 +1080,8 @@ struct tui_context {
     uint32_t current_fg;
     uint32_t current_bg;
     uint8_t  current_style;
+    tui_style style_stack[TUI_STYLE_STACK_DEPTH];
+    int style_depth;            /* May exceed the stack; see tui_push_style */
     
     /* Input handling */
     uint8_t input_buffer[TUI_INPUT_BUFFER_SIZE];
@@ -593,11 +1102,13 @@ struct tui_context {
     int hot_button_y;
     bool button_pressed;
     
+#ifndef TUI_NO_MOUSE
     /* Mouse state */
     bool mouse_enabled;
     int mouse_x;
     int mouse_y;
     tui_mouse_button mouse_button;
+#endif
     
     /* Resize state */
     bool resized;
@@ -615,8 +1126,9 @@ struct tui_context {
     int tty_fd;
 #endif
     
-    /* Theme */
+    /* Theme and the styles resolved from it */
     const tui_theme* theme;
+    tui_style tokens[TUI_TOKEN_COUNT];
     
     /* Underline color (0x80000000 = default/none) */
     uint32_t current_underline_color;
@@ -633,6 +1145,32 @@ struct tui_context {
     bool initialized;
     bool in_frame;
     bool needs_redraw;  /* Force full screen redraw on next frame */
+    
+    /* Save-under snapshots */
+    tui_save_slot save_under[TUI_SAVE_UNDER_SLOTS];
+    bool frame_retained;  /* Back buffer still holds last frame's cells */
+    
+    /* Drawing clip, [x0, x1) x [y0, y1) within the screen */
+    int clip_x0, clip_y0;
+    int clip_x1, clip_y1;
+    
+    /* Hyperlinks: URL of ID i at links[i - 1], open-addressed index by URL */
+    char** links;
+    int link_count;
+    int link_capacity;
+    uint16_t* link_slots;       /* IDs, 0 = empty */
+    int link_slot_count;        /* Power of two */
+    uint16_t current_link;
+    
+    tui_strings* strings;       /* Resolves widget string handles (not owned) */
+    
+    /* OSC 52 stream */
+    size_t clipboard_limit;     /* Max encoded bytes (0 = unlimited) */
+    size_t clipboard_total;     /* Declared length of the open stream */
+    size_t clipboard_written;
+    uint8_t clipboard_carry[2]; /* Bytes short of a 3-byte group */
+    int clipboard_carry_len;
+    bool clipboard_open;
 };
 
 /* ============================================================================
@@ -825,16 +1363,11 @@ static void tui_ansi_end_sync(tui_context* ctx) {
     tui_output_str(ctx, "\x1b[?2026l");
 }
 
-/* Set clipboard via OSC 52 */
-static void tui_ansi_set_clipboard(tui_context* ctx, const char* base64_text) {
-    tui_output_str(ctx, "\x1b]52;c;");
-    tui_output_str(ctx, base64_text);
-    tui_output_str(ctx, "\x1b\\");
-}
-
-/* Start hyperlink (OSC 8) */
-static void tui_ansi_hyperlink_start(tui_context* ctx, const char* url) {
-    tui_output_str(ctx, "\x1b]8;;");
+/* Start hyperlink (OSC 8); the id lets terminals join split runs */
+static void tui_ansi_hyperlink_start(tui_context* ctx, uint16_t id, const char* url) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "\x1b]8;id=%u;", (unsigned)id);
+    tui_output_str(ctx, buf);
     tui_output_str(ctx, url);
     tui_output_str(ctx, "\x1b\\");
 }
@@ -860,6 +1393,7 @@ static void tui_ansi_clear_screen(tui_context* ctx) {
     tui_output_str(ctx, "\x1b[0m\x1b[2J\x1b[H");
 }
 
+#ifndef TUI_NO_MOUSE
 /* Enable mouse tracking with SGR extended mode for better coordinates */
 static void tui_ansi_enable_mouse(tui_context* ctx) {
     /* 1000: basic mouse tracking, 1002: button motion, 1006: SGR extended */
@@ -870,6 +1404,7 @@ static void tui_ansi_enable_mouse(tui_context* ctx) {
 static void tui_ansi_disable_mouse(tui_context* ctx) {
     tui_output_str(ctx, "\x1b[?1006l\x1b[?1002l\x1b[?1000l");
 }
+#endif
 
 /* ============================================================================
  * Internal Helpers - Wide Character Width (wcwidth implementation)
@@ -923,40 +1458,39 @@ int tui_char_width(uint32_t cp) {
 static const char tui_base64_table[] = 
     "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-static int tui_base64_encode(const char* input, int input_len, char* output, int output_size) {
-    int i = 0, j = 0;
-    uint8_t a3[3], a4[4];
-    int a3_len = 0;
-    
-    while (i < input_len) {
-        a3[a3_len++] = (uint8_t)input[i++];
-        if (a3_len == 3) {
-            a4[0] = (a3[0] >> 2) & 0x3F;
-            a4[1] = ((a3[0] << 4) | (a3[1] >> 4)) & 0x3F;
-            a4[2] = ((a3[1] << 2) | (a3[2] >> 6)) & 0x3F;
-            a4[3] = a3[2] & 0x3F;
-            for (int k = 0; k < 4 && j < output_size - 1; k++) {
-                output[j++] = tui_base64_table[a4[k]];
-            }
-            a3_len = 0;
+/* Encode whole 3-byte groups straight into the output buffer, flushing
+ * between chunks. Four groups per iteration with no per-byte checks. */
+static void tui_base64_stream(tui_context* ctx, const uint8_t* in, size_t groups) {
+    while (groups > 0) {
+        int space = TUI_OUTPUT_BUFFER_SIZE - ctx->output_pos;
+        if (space < 16) {
+            tui_output_flush(ctx);
+            space = TUI_OUTPUT_BUFFER_SIZE - ctx->output_pos;
         }
-    }
-    
-    if (a3_len > 0) {
-        for (int k = a3_len; k < 3; k++) a3[k] = 0;
-        a4[0] = (a3[0] >> 2) & 0x3F;
-        a4[1] = ((a3[0] << 4) | (a3[1] >> 4)) & 0x3F;
-        a4[2] = ((a3[1] << 2) | (a3[2] >> 6)) & 0x3F;
-        for (int k = 0; k < a3_len + 1 && j < output_size - 1; k++) {
-            output[j++] = tui_base64_table[a4[k]];
+        size_t n = (size_t)(space / 4) < groups ? (size_t)(space / 4) : groups;
+        char* out = ctx->output_buffer + ctx->output_pos;
+        
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4, in += 12, out += 16) {
+            for (int k = 0; k < 4; k++) {
+                uint32_t v = ((uint32_t)in[3 * k] << 16) | ((uint32_t)in[3 * k + 1] << 8) | in[3 * k + 2];
+                out[4 * k] = tui_base64_table[v >> 18];
+                out[4 * k + 1] = tui_base64_table[(v >> 12) & 0x3F];
+                out[4 * k + 2] = tui_base64_table[(v >> 6) & 0x3F];
+                out[4 * k + 3] = tui_base64_table[v & 0x3F];
+            }
         }
-        while (a3_len++ < 3 && j < output_size - 1) {
-            output[j++] = '=';
+        for (; i < n; i++, in += 3, out += 4) {
+            uint32_t v = ((uint32_t)in[0] << 16) | ((uint32_t)in[1] << 8) | in[2];
+            out[0] = tui_base64_table[v >> 18];
+            out[1] = tui_base64_table[(v >> 12) & 0x3F];
+            out[2] = tui_base64_table[(v >> 6) & 0x3F];
+            out[3] = tui_base64_table[v & 0x3F];
         }
+        
+        ctx->output_pos += (int)(n * 4);
+        groups -= n;
     }
-    
-    output[j] = '\0';
-    return j;
 }
 
 /* ============================================================================
@@ -1055,6 +1589,7 @@ static tui_cell tui_make_empty_cell(void) {
     cell.bg = TUI_COLOR_DEFAULT;
     cell.underline_color = TUI_COLOR_DEFAULT;
     cell.style = TUI_STYLE_NONE;
+    cell.link = 0;
     return cell;
 }
 
@@ -1073,7 +1608,8 @@ static bool tui_cell_equal(const tui_cell* a, const tui_cell* b) {
            a->fg == b->fg &&
            a->bg == b->bg &&
            a->underline_color == b->underline_color &&
-           a->style == b->style;
+           a->style == b->style &&
+           a->link == b->link;
 }
 
 /* ============================================================================
@@ -1414,9 +1950,12 @@ static int tui_parse_escape_sequence(tui_context* ctx, tui_event* event) {
     event->type = TUI_EVENT_NONE;
     event->key = TUI_KEY_NONE;
     event->ch = 0;
+#ifndef TUI_NO_MOUSE
     event->mouse_button = TUI_MOUSE_NONE;
     event->mouse_x = 0;
     event->mouse_y = 0;
+    event->mouse_drag = false;
+#endif
     event->ctrl = false;
     event->alt = false;
     event->shift = false;
@@ -1470,6 +2009,7 @@ static int tui_parse_escape_sequence(tui_context* ctx, tui_event* event) {
                 }
             }
             
+#ifndef TUI_NO_MOUSE
             /* Check for SGR mouse sequence: ESC [ < ... */
             if (b2 == '<') {
                 int params[4] = {0};
@@ -1487,6 +2027,10 @@ static int tui_parse_escape_sequence(tui_context* ctx, tui_event* event) {
                     event->type = TUI_EVENT_MOUSE;
                     event->mouse_x = mx;
                     event->mouse_y = my;
+                    event->shift = (button_code & 4) != 0;
+                    event->alt = (button_code & 8) != 0;
+                    event->ctrl = (button_code & 16) != 0;
+                    event->mouse_drag = final_char == 'M' && (button_code & 32) != 0;
                     
                     if (final_char == 'm') {
                         event->mouse_button = TUI_MOUSE_RELEASE;
@@ -1512,6 +2056,7 @@ static int tui_parse_escape_sequence(tui_context* ctx, tui_event* event) {
                     return 1;
                 }
             }
+#endif
             
             /* Simple arrow keys */
             switch (b2) {
@@ -1795,7 +2340,8 @@ tui_context* tui_create(void) {
     ctx->is_pasting = false;
     
     /* Initialize theme */
-    ctx->theme = &TUI_THEME_DEFAULT;
+    tui_set_theme(ctx, NULL);
+    ctx->clipboard_limit = TUI_CLIPBOARD_DEFAULT_LIMIT;
     
     /* Enter alternate screen and hide cursor */
     tui_ansi_enter_alt_screen(ctx);
@@ -1814,9 +2360,11 @@ void tui_destroy(tui_context* ctx) {
     
     if (ctx->initialized) {
         /* Disable features */
+#ifndef TUI_NO_MOUSE
         if (ctx->mouse_enabled) {
             tui_ansi_disable_mouse(ctx);
         }
+#endif
         if (ctx->bracketed_paste_enabled) {
             tui_ansi_disable_bracketed_paste(ctx);
         }
@@ -1841,6 +2389,14 @@ void tui_destroy(tui_context* ctx) {
 #endif
     }
     
+    for (int i = 0; i < TUI_SAVE_UNDER_SLOTS; i++) {
+        free(ctx->save_under[i].cells);
+    }
+    for (int i = 0; i < ctx->link_count; i++) {
+        free(ctx->links[i]);
+    }
+    free(ctx->links);
+    free(ctx->link_slots);
     free(ctx->front_buffer);
     free(ctx->back_buffer);
     free(ctx);
@@ -1857,19 +2413,32 @@ void tui_clear(tui_context* ctx) {
     }
 }
 
-void tui_begin_frame(tui_context* ctx) {
-    if (!ctx || !ctx->initialized) return;
+static void tui_invalidate_all_under(tui_context* ctx) {
+    for (int i = 0; i < TUI_SAVE_UNDER_SLOTS; i++) {
+        ctx->save_under[i].valid = false;
+    }
+}
+
+static void tui_begin_frame_common(tui_context* ctx, bool retain) {
+    int old_w = ctx->width;
+    int old_h = ctx->height;
     
     /* Update terminal size */
     tui_get_terminal_size(ctx);
     
     /* Clear back buffer - use MAX_WIDTH/MAX_HEIGHT to clear entire buffer */
-    tui_clear_buffer(ctx->back_buffer, TUI_MAX_WIDTH, TUI_MAX_HEIGHT);
+    ctx->frame_retained = retain && !ctx->needs_redraw && ctx->width == old_w && ctx->height == old_h;
+    if (!ctx->frame_retained) {
+        tui_clear_buffer(ctx->back_buffer, TUI_MAX_WIDTH, TUI_MAX_HEIGHT);
+        tui_invalidate_all_under(ctx);
+    }
     
     /* Reset drawing state */
+    tui_reset_clip(ctx);
     ctx->current_fg = TUI_COLOR_DEFAULT;
     ctx->current_bg = TUI_COLOR_DEFAULT;
     ctx->current_style = TUI_STYLE_NONE;
+    ctx->style_depth = 0;
     
     /* Reset button state for this frame */
     ctx->button_pressed = false;
@@ -1877,6 +2446,127 @@ void tui_begin_frame(tui_context* ctx) {
     ctx->in_frame = true;
 }
 
+void tui_begin_frame(tui_context* ctx) {
+    if (!ctx || !ctx->initialized) return;
+    tui_begin_frame_common(ctx, false);
+}
+
+/* Keep last frame's cells: only what is redrawn changes (a resize clears) */
+void tui_begin_frame_retained(tui_context* ctx) {
+    if (!ctx || !ctx->initialized) return;
+    tui_begin_frame_common(ctx, true);
+}
+
+/* ============================================================================
+ * Frame Diff Kernels
+ * ============================================================================ */
+
+/* SGR/cursor state carried across the cells emitted in one frame */
+typedef struct {
+    uint32_t last_fg;
+    uint32_t last_bg;
+    uint32_t last_underline_color;
+    uint8_t last_style;
+    uint16_t open_link;
+    int last_x;
+    int last_y;
+} tui_render_state;
+
+/* Which optional cell features the visible back buffer uses (branch-free scan) */
+static unsigned tui_frame_features(tui_context* ctx) {
+    uint32_t style = 0, underline = 0, link = 0;
+    for (int y = 0; y < ctx->height; y++) {
+        const tui_cell* row = &ctx->back_buffer[y * TUI_MAX_WIDTH];
+        for (int x = 0; x < ctx->width; x++) {
+            style |= row[x].style;
+            underline |= row[x].underline_color ^ TUI_COLOR_DEFAULT;
+            link |= row[x].link;
+        }
+    }
+    return (style ? TUI_RENDER_STYLE : 0) |
+           (underline ? TUI_RENDER_UNDERLINE : 0) |
+           (link ? TUI_RENDER_LINK : 0);
+}
+
+/*
+ * Each kernel diffs the visible frame and encodes changed cells. Features
+ * the frame doesn't use compile out: without STYLE every cell is plain, so
+ * only the first emitted cell needs the reset; without UNDERLINE the reset
+ * already leaves the underline color at its default; without LINK no OSC 8
+ * is ever open.
+ */
+#define TUI_DEFINE_RENDER_KERNEL(name, STYLE, UNDERLINE, LINK)                  \
+static void name(tui_context* ctx, tui_render_state* rs) {                      \
+    for (int y = 0; y < ctx->height; y++) {                                     \
+        tui_cell* front_row = &ctx->front_buffer[y * TUI_MAX_WIDTH];            \
+        const tui_cell* back_row = &ctx->back_buffer[y * TUI_MAX_WIDTH];        \
+        for (int x = 0; x < ctx->width; x++) {                                  \
+            const tui_cell* back = &back_row[x];                                \
+            if (tui_cell_equal(&front_row[x], back)) continue;                  \
+                                                                                \
+            if (rs->last_x != x - 1 || rs->last_y != y) {                       \
+                tui_ansi_move_cursor(ctx, x, y);                                \
+            }                                                                   \
+            if ((STYLE) ? back->style != rs->last_style : rs->last_style != 0) { \
+                tui_ansi_reset(ctx);                                            \
+                if (STYLE) tui_ansi_set_style(ctx, back->style);                \
+                rs->last_style = back->style;                                   \
+                rs->last_fg = 0xFFFFFFFF;                                       \
+                rs->last_bg = 0xFFFFFFFF;                                       \
+                rs->last_underline_color = 0xFFFFFFFF;                          \
+            }                                                                   \
+            if (back->fg != rs->last_fg) {                                      \
+                tui_ansi_set_fg(ctx, back->fg);                                 \
+                rs->last_fg = back->fg;                                         \
+            }                                                                   \
+            if (back->bg != rs->last_bg) {                                      \
+                tui_ansi_set_bg(ctx, back->bg);                                 \
+                rs->last_bg = back->bg;                                         \
+            }                                                                   \
+            if ((UNDERLINE) && back->underline_color != rs->last_underline_color) { \
+                tui_ansi_set_underline_color(ctx, back->underline_color);      \
+                rs->last_underline_color = back->underline_color;               \
+            }                                                                   \
+            if ((LINK) && back->link != rs->open_link) {                        \
+                if (rs->open_link) tui_ansi_hyperlink_end(ctx);                 \
+                if (back->link && back->link <= ctx->link_count) {              \
+                    tui_ansi_hyperlink_start(ctx, back->link, ctx->links[back->link - 1]); \
+                }                                                               \
+                rs->open_link = back->link;                                     \
+            }                                                                   \
+                                                                                \
+            if (back->codepoint < 0x80) {                                       \
+                char c = (char)back->codepoint;                                 \
+                tui_output_write(ctx, &c, 1);                                   \
+            } else {                                                            \
+                char utf8[4];                                                   \
+                tui_output_write(ctx, utf8, tui_utf8_encode(back->codepoint, utf8)); \
+            }                                                                   \
+                                                                                \
+            front_row[x] = *back;                                               \
+            rs->last_x = x;                                                     \
+            rs->last_y = y;                                                     \
+        }                                                                       \
+    }                                                                           \
+}
+
+TUI_DEFINE_RENDER_KERNEL(tui_render_plain,           0, 0, 0)
+TUI_DEFINE_RENDER_KERNEL(tui_render_s,               1, 0, 0)
+TUI_DEFINE_RENDER_KERNEL(tui_render_u,               0, 1, 0)
+TUI_DEFINE_RENDER_KERNEL(tui_render_su,              1, 1, 0)
+TUI_DEFINE_RENDER_KERNEL(tui_render_l,               0, 0, 1)
+TUI_DEFINE_RENDER_KERNEL(tui_render_sl,              1, 0, 1)
+TUI_DEFINE_RENDER_KERNEL(tui_render_ul,              0, 1, 1)
+TUI_DEFINE_RENDER_KERNEL(tui_render_full,            1, 1, 1)
+
+#undef TUI_DEFINE_RENDER_KERNEL
+
+/* Indexed by tui_frame_features() */
+static void (*const tui_render_kernels[TUI_RENDER_VARIANTS])(tui_context*, tui_render_state*) = {
+    tui_render_plain, tui_render_s, tui_render_u, tui_render_su,
+    tui_render_l, tui_render_sl, tui_render_ul, tui_render_full
+};
+
 void tui_end_frame(tui_context* ctx) {
     if (!ctx || !ctx->initialized || !ctx->in_frame) return;
     
@@ -1895,69 +2585,11 @@ void tui_end_frame(tui_context* ctx) {
     /* Begin synchronized output (prevents tearing on supported terminals) */
     tui_ansi_begin_sync(ctx);
     
-    /* Diff-based rendering */
-    uint32_t last_fg = 0xFFFFFFFF;
-    uint32_t last_bg = 0xFFFFFFFF;
-    uint32_t last_underline_color = 0xFFFFFFFF;
-    uint8_t last_style = 0xFF;
-    int last_x = -2;
-    int last_y = -2;
+    /* Diff-based rendering with the kernel matching this frame's features */
+    tui_render_state rs = {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFF, 0, -2, -2};
+    tui_render_kernels[tui_frame_features(ctx)](ctx, &rs);
     
-    for (int y = 0; y < ctx->height; y++) {
-        for (int x = 0; x < ctx->width; x++) {
-            int idx = y * TUI_MAX_WIDTH + x;
-            tui_cell* front = &ctx->front_buffer[idx];
-            tui_cell* back = &ctx->back_buffer[idx];
-            
-            if (!tui_cell_equal(front, back)) {
-                /* Cell has changed, need to update */
-                
-                /* Move cursor if not adjacent */
-                if (last_x != x - 1 || last_y != y) {
-                    tui_ansi_move_cursor(ctx, x, y);
-                }
-                
-                /* Update style if changed */
-                if (back->style != last_style) {
-                    tui_ansi_reset(ctx);
-                    tui_ansi_set_style(ctx, back->style);
-                    last_style = back->style;
-                    last_fg = 0xFFFFFFFF;
-                    last_bg = 0xFFFFFFFF;
-                    last_underline_color = 0xFFFFFFFF;
-                }
-                
-                /* Update foreground if changed */
-                if (back->fg != last_fg) {
-                    tui_ansi_set_fg(ctx, back->fg);
-                    last_fg = back->fg;
-                }
-                
-                /* Update background if changed */
-                if (back->bg != last_bg) {
-                    tui_ansi_set_bg(ctx, back->bg);
-                    last_bg = back->bg;
-                }
-                
-                /* Update underline color if changed (for undercurl/colored underlines) */
-                if (back->underline_color != last_underline_color) {
-                    tui_ansi_set_underline_color(ctx, back->underline_color);
-                    last_underline_color = back->underline_color;
-                }
-                
-                /* Output character */
-                char utf8[4];
-                int len = tui_utf8_encode(back->codepoint, utf8);
-                tui_output_write(ctx, utf8, len);
-                
-                /* Update front buffer */
-                *front = *back;
-                
-                last_x = x;
-                last_y = y;
-            }
-        }
-    }
+    if (rs.open_link) tui_ansi_hyperlink_end(ctx);
     
     /* Position cursor */
     if (ctx->cursor_visible) {
@@ -1993,9 +2625,61 @@ void tui_set_style(tui_context* ctx, uint8_t style) {
     if (ctx) ctx->current_style = style;
 }
 
+tui_style tui_style_make(uint32_t fg, uint32_t bg, uint8_t attrs) {
+    tui_style style = {fg, bg, TUI_COLOR_DEFAULT, attrs};
+    return style;
+}
+
+tui_style tui_get_current_style(tui_context* ctx) {
+    if (!ctx) return tui_style_make(TUI_COLOR_DEFAULT, TUI_COLOR_DEFAULT, TUI_STYLE_NONE);
+    tui_style style = {ctx->current_fg, ctx->current_bg, ctx->current_underline_color, ctx->current_style};
+    return style;
+}
+
+void tui_apply_style(tui_context* ctx, tui_style style) {
+    if (!ctx) return;
+    ctx->current_fg = style.fg;
+    ctx->current_bg = style.bg;
+    ctx->current_underline_color = style.underline_color;
+    ctx->current_style = style.attrs;
+}
+
+void tui_push_style(tui_context* ctx, tui_style style) {
+    if (!ctx) return;
+    if (ctx->style_depth < TUI_STYLE_STACK_DEPTH) {
+        ctx->style_stack[ctx->style_depth] = tui_get_current_style(ctx);
+    }
+    ctx->style_depth++;
+    tui_apply_style(ctx, style);
+}
+
+void tui_pop_style(tui_context* ctx) {
+    if (!ctx || ctx->style_depth == 0) return;
+    ctx->style_depth--;
+    if (ctx->style_depth < TUI_STYLE_STACK_DEPTH) {
+        tui_apply_style(ctx, ctx->style_stack[ctx->style_depth]);
+    }
+}
+
+void tui_set_clip(tui_context* ctx, int x, int y, int w, int h) {
+    if (!ctx) return;
+    ctx->clip_x0 = x < 0 ? 0 : x;
+    ctx->clip_y0 = y < 0 ? 0 : y;
+    ctx->clip_x1 = x + w > ctx->width ? ctx->width : x + w;
+    ctx->clip_y1 = y + h > ctx->height ? ctx->height : y + h;
+}
+
+void tui_reset_clip(tui_context* ctx) {
+    if (!ctx) return;
+    ctx->clip_x0 = 0;
+    ctx->clip_y0 = 0;
+    ctx->clip_x1 = ctx->width;
+    ctx->clip_y1 = ctx->height;
+}
+
 void tui_set_cell(tui_context* ctx, int x, int y, uint32_t codepoint) {
     if (!ctx || !ctx->in_frame) return;
-    if (x < 0 || x >= ctx->width || y < 0 || y >= ctx->height) return;
+    if (x < ctx->clip_x0 || x >= ctx->clip_x1 || y < ctx->clip_y0 || y >= ctx->clip_y1) return;
     
     int idx = y * TUI_MAX_WIDTH + x;
     ctx->back_buffer[idx].codepoint = codepoint;
@@ -2003,43 +2687,306 @@ void tui_set_cell(tui_context* ctx, int x, int y, uint32_t codepoint) {
     ctx->back_buffer[idx].bg = ctx->current_bg;
     ctx->back_buffer[idx].underline_color = ctx->current_underline_color;
     ctx->back_buffer[idx].style = ctx->current_style;
+    ctx->back_buffer[idx].link = ctx->current_link;
 }
 
-void tui_label(tui_context* ctx, int x, int y, const char* text) {
-    if (!ctx || !ctx->in_frame || !text) return;
-    
+/* Places text the way tui_label does: '\n' returns to the start column,
+ * wide characters take two cells, and nothing more is drawn once the
+ * pen passes the right clip edge */
+typedef struct {
+    tui_context* ctx;
+    int x0;
+    int x;
+    int y;
+} tui_text_pen;
+
+static void tui_pen_put(tui_text_pen* pen, uint32_t codepoint) {
+    tui_context* ctx = pen->ctx;
+    if (pen->x >= ctx->clip_x1) return;
+    
+    if (codepoint == '\n') {
+        pen->y++;
+        pen->x = pen->x0;
+    } else if (codepoint >= 32) {
+        int char_width = tui_char_width(codepoint);
+        if (char_width == 2) {
+            /* Wide character (CJK, emoji); skipped if it does not fit */
+            if (pen->x + 1 < ctx->clip_x1) tui_set_cell_wide(ctx, pen->x, pen->y, codepoint);
+            pen->x += pen->x + 1 < ctx->clip_x1 ? 2 : 1;
+        } else if (char_width == 1) {
+            tui_set_cell(ctx, pen->x, pen->y, codepoint);
+            pen->x++;
+        }
+        /* char_width == 0 means combining char, don't advance */
+    }
+}
+
+static void tui_pen_text(tui_text_pen* pen, const char* text, int len) {
     const uint8_t* ptr = (const uint8_t*)text;
-    int len = (int)strlen(text);
     int pos = 0;
-    int cur_x = x;
+    while (pos < len && pen->x < pen->ctx->clip_x1) {
+        if (ptr[pos] < 0x80) {
+            tui_pen_put(pen, ptr[pos++]);
+            continue;
+        }
+        uint32_t codepoint;
+        pos += tui_utf8_decode(ptr + pos, len - pos, &codepoint);
+        tui_pen_put(pen, codepoint);
+    }
+}
+
+static void tui_pen_fill(tui_text_pen* pen, char ch, int count) {
+    for (int i = 0; i < count; i++) tui_pen_put(pen, (uint32_t)(uint8_t)ch);
+}
+
+static const char tui_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/* Digits of v written backwards ending at end; returns the start */
+static char* tui_fmt_u64(char* end, uint64_t v) {
+    while (v >= 100) {
+        const char* pair = &tui_digit_pairs[(v % 100) * 2];
+        v /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (v >= 10) {
+        *--end = tui_digit_pairs[v * 2 + 1];
+        *--end = tui_digit_pairs[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+static char* tui_fmt_hex(char* end, uint64_t v, bool upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    do {
+        *--end = digits[v & 0xF];
+        v >>= 4;
+    } while (v);
+    return end;
+}
+
+/* Fixed-point %f into buf (at least 64 bytes); returns the length. Cases the
+ * fast path can't round exactly go through snprintf, still on the stack. */
+static int tui_fmt_fixed(char* buf, double v, int precision, char sign) {
+    static const double scales[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    double a = v < 0 ? -v : v;
+    double x = precision <= 9 ? a * scales[precision] : 0.0;
+    
+    /* Below 2^52 the product keeps half-unit resolution, so its rounding error
+     * (at most half an ulp) only matters when it lands exactly on .5: then the
+     * decimal value may sit on either side of the tie */
+    uint64_t scaled = (uint64_t)(x < 4503599627370496.0 ? x : 0.0);
+    double rest = x - (double)scaled;
+    if (precision > 9 || a != a || x >= 4503599627370496.0 || rest == 0.5) {
+        int len = snprintf(buf, 64, sign == '+' ? "%+.*f" : sign == ' ' ? "% .*f" : "%.*f", precision, v);
+        return len < 64 ? len : 63;
+    }
+    if (rest > 0.5) scaled++;
+    uint64_t whole = scaled / (uint64_t)scales[precision];
+    uint64_t frac = scaled % (uint64_t)scales[precision];
+    
+    char tmp[48];
+    char* end = tmp + sizeof(tmp);
+    char* p = end;
+    if (precision > 0) {
+        for (int i = 0; i < precision; i++) {
+            *--p = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        *--p = '.';
+    }
+    p = tui_fmt_u64(p, whole);
+    if (v < 0 || (v == 0 && 1.0 / v < 0)) *--p = '-';  /* printf keeps -0.00 */
+    else if (sign) *--p = sign;
     
-    while (pos < len && cur_x < ctx->width) {
+    int len = (int)(end - p);
+    memcpy(buf, p, (size_t)len);
+    return len;
+}
+
+/* Display width of len bytes, as tui_pen_text would advance */
+static int tui_fmt_width(const char* text, int len) {
+    const uint8_t* ptr = (const uint8_t*)text;
+    int width = 0;
+    for (int pos = 0; pos < len;) {
+        if (ptr[pos] < 0x80) {
+            width += ptr[pos++] >= 32;
+            continue;
+        }
         uint32_t codepoint;
-        int char_len = tui_utf8_decode(ptr + pos, len - pos, &codepoint);
+        pos += tui_utf8_decode(ptr + pos, len - pos, &codepoint);
+        width += tui_char_width(codepoint);
+    }
+    return width;
+}
+
+void tui_label(tui_context* ctx, int x, int y, const char* text) {
+    if (!ctx || !ctx->in_frame || !text) return;
+    tui_text_pen pen = {ctx, x, x, y};
+    tui_pen_text(&pen, text, (int)strlen(text));
+}
+
+void tui_labelf(tui_context* ctx, int x, int y, const char* fmt, ...) {
+    if (!ctx || !ctx->in_frame || !fmt) return;
+    
+    tui_text_pen pen = {ctx, x, x, y};
+    va_list args;
+    va_start(args, fmt);
+    
+    const char* p = fmt;
+    while (*p) {
+        /* Literal run */
+        const char* run = p;
+        while (*p && *p != '%') p++;
+        if (p > run) tui_pen_text(&pen, run, (int)(p - run));
+        if (!*p) break;
         
-        if (codepoint == '\n') {
-            y++;
-            cur_x = x;
-        } else if (codepoint >= 32) {
-            int char_width = tui_char_width(codepoint);
-            if (char_width == 2) {
-                /* Wide character (CJK, emoji) */
-                if (cur_x + 1 < ctx->width) {
-                    tui_set_cell_wide(ctx, cur_x, y, codepoint);
-                    cur_x += 2;
+        const char* spec = p++;
+        bool left = false, zero = false;
+        char sign = 0;  /* Shown before non-negative numbers: '+', ' ' or none */
+        for (;; p++) {
+            if (*p == '-') left = true;
+            else if (*p == '0') zero = true;
+            else if (*p == '+') sign = '+';
+            else if (*p == ' ') { if (!sign) sign = ' '; }
+            else break;
+        }
+        
+        int width = 0;
+        if (*p == '*') {
+            width = va_arg(args, int);
+            if (width < 0) {
+                left = true;
+                width = -width;
+            }
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') width = width * 10 + (*p++ - '0');
+        }
+        
+        int precision = -1;
+        if (*p == '.') {
+            p++;
+            precision = 0;
+            if (*p == '*') {
+                precision = va_arg(args, int);
+                p++;
+            } else {
+                while (*p >= '0' && *p <= '9') precision = precision * 10 + (*p++ - '0');
+            }
+        }
+        
+        int longs = 0;
+        bool size = false;
+        while (*p == 'l' || *p == 'h' || *p == 'z') {
+            if (*p == 'l') longs++;
+            if (*p == 'z') size = true;
+            p++;
+        }
+        
+        char buf[64];
+        const char* out = buf;
+        int out_len = 0;
+        bool numeric = true;
+        char* end = buf + sizeof(buf);
+        
+        switch (*p) {
+            case 'd':
+            case 'i': {
+                long long v = longs >= 2 ? va_arg(args, long long) :
+                              longs == 1 ? va_arg(args, long) :
+                              size ? (long long)va_arg(args, size_t) : va_arg(args, int);
+                uint64_t mag = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+                char* start = tui_fmt_u64(end, mag);
+                if (v < 0) *--start = '-';
+                else if (sign) *--start = sign;
+                out = start;
+                out_len = (int)(end - start);
+                break;
+            }
+            case 'u':
+            case 'x':
+            case 'X': {
+                uint64_t v = longs >= 2 ? va_arg(args, unsigned long long) :
+                             longs == 1 ? va_arg(args, unsigned long) :
+                             size ? va_arg(args, size_t) : va_arg(args, unsigned int);
+                char* start = (*p == 'u') ? tui_fmt_u64(end, v) : tui_fmt_hex(end, v, *p == 'X');
+                out = start;
+                out_len = (int)(end - start);
+                break;
+            }
+            case 'f':
+            case 'F':
+                out_len = tui_fmt_fixed(buf, va_arg(args, double), precision < 0 ? 6 : precision, sign);
+                break;
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                /* Rare in draw code: delegate, but keep it on the stack */
+                char f[6];
+                int k = 0;
+                f[k++] = '%';
+                if (sign) f[k++] = sign;
+                f[k++] = '.';
+                f[k++] = '*';
+                f[k++] = *p;
+                f[k] = '\0';
+                out_len = snprintf(buf, sizeof(buf), f, precision < 0 ? 6 : precision, va_arg(args, double));
+                if (out_len >= (int)sizeof(buf)) out_len = (int)sizeof(buf) - 1;
+                break;
+            }
+            case 'c':
+                buf[0] = (char)va_arg(args, int);
+                out_len = 1;
+                numeric = false;
+                break;
+            case 's': {
+                const char* s = va_arg(args, const char*);
+                if (!s) s = "(null)";
+                out = s;
+                if (precision >= 0) {
+                    const char* nul = (const char*)memchr(s, '\0', (size_t)precision);
+                    out_len = nul ? (int)(nul - s) : precision;
                 } else {
-                    /* Not enough space, skip */
-                    cur_x++;
+                    out_len = (int)strlen(s);
                 }
-            } else if (char_width == 1) {
-                tui_set_cell(ctx, cur_x, y, codepoint);
-                cur_x++;
+                numeric = false;
+                break;
             }
-            /* char_width == 0 means combining char, don't advance */
+            case '%':
+                buf[0] = '%';
+                out_len = 1;
+                numeric = false;
+                break;
+            default:
+                /* Unknown conversion: its argument can't be skipped safely,
+                 * so the rest of the format is drawn as written */
+                tui_pen_text(&pen, spec, (int)strlen(spec));
+                va_end(args);
+                return;
         }
+        p++;
         
-        pos += char_len;
+        int pad = width - (numeric ? out_len : tui_fmt_width(out, out_len));
+        if (pad > 0 && !left) {
+            if (zero && numeric && (out[0] == '-' || out[0] == '+' || out[0] == ' ')) {
+                tui_pen_put(&pen, (uint8_t)out[0]);
+                out++;
+                out_len--;
+            }
+            tui_pen_fill(&pen, zero && numeric ? '0' : ' ', pad);
+        }
+        tui_pen_text(&pen, out, out_len);
+        if (pad > 0 && left) tui_pen_fill(&pen, ' ', pad);
     }
+    
+    va_end(args);
 }
 
 int tui_button(tui_context* ctx, int x, int y, const char* text) {
@@ -2051,21 +2998,8 @@ int tui_button(tui_context* ctx, int x, int y, const char* text) {
     /* Check if this button is "hot" (focused) */
     bool is_hot = (ctx->hot_button_x == x && ctx->hot_button_y == y);
     
-    /* Save current colors */
-    uint32_t save_fg = ctx->current_fg;
-    uint32_t save_bg = ctx->current_bg;
-    uint8_t save_style = ctx->current_style;
-    
-    /* Set button colors */
-    if (is_hot) {
-        ctx->current_fg = TUI_COLOR_BLACK;
-        ctx->current_bg = TUI_COLOR_WHITE;
-        ctx->current_style = TUI_STYLE_BOLD;
-    } else {
-        ctx->current_fg = TUI_COLOR_WHITE;
-        ctx->current_bg = TUI_RGB(60, 60, 60);
-        ctx->current_style = TUI_STYLE_NONE;
-    }
+    /* Button colors */
+    tui_push_token(ctx, is_hot ? TUI_TOKEN_BUTTON_FOCUSED : TUI_TOKEN_BUTTON);
     
     /* Draw button frame */
     tui_set_cell(ctx, x, y, '[');
@@ -2084,11 +3018,7 @@ int tui_button(tui_context* ctx, int x, int y, const char* text) {
     
     tui_set_cell(ctx, cur_x, y, ' ');
     tui_set_cell(ctx, cur_x + 1, y, ']');
-    
-    /* Restore colors */
-    ctx->current_fg = save_fg;
-    ctx->current_bg = save_bg;
-    ctx->current_style = save_style;
+    tui_pop_style(ctx);
     
     /* Return 1 if button was pressed */
     return (is_hot && ctx->button_pressed) ? 1 : 0;
@@ -2101,9 +3031,12 @@ int tui_poll_event(tui_context* ctx, tui_event* event) {
     event->type = TUI_EVENT_NONE;
     event->key = TUI_KEY_NONE;
     event->ch = 0;
+#ifndef TUI_NO_MOUSE
     event->mouse_button = TUI_MOUSE_NONE;
     event->mouse_x = 0;
     event->mouse_y = 0;
+    event->mouse_drag = false;
+#endif
     event->new_width = 0;
     event->new_height = 0;
     
@@ -2135,12 +3068,14 @@ int tui_poll_event(tui_context* ctx, tui_event* event) {
     /* Parse input buffer */
     if (tui_input_available(ctx) > 0) {
         if (tui_parse_escape_sequence(ctx, event)) {
+#ifndef TUI_NO_MOUSE
             /* Update mouse state */
             if (event->type == TUI_EVENT_MOUSE) {
                 ctx->mouse_x = event->mouse_x;
                 ctx->mouse_y = event->mouse_y;
                 ctx->mouse_button = event->mouse_button;
             }
+#endif
             /* Update button state for navigation */
             if (event->key == TUI_KEY_ENTER) {
                 ctx->button_pressed = true;
@@ -2173,6 +3108,7 @@ void tui_show_cursor(tui_context* ctx, bool show) {
     }
 }
 
+#ifndef TUI_NO_MOUSE
 void tui_enable_mouse(tui_context* ctx) {
     if (ctx && !ctx->mouse_enabled) {
         ctx->mouse_enabled = true;
@@ -2188,6 +3124,7 @@ void tui_disable_mouse(tui_context* ctx) {
         tui_output_flush(ctx);
     }
 }
+#endif
 
 bool tui_resized(tui_context* ctx) {
     if (!ctx) return false;
@@ -2284,38 +3221,189 @@ void tui_end_sync(tui_context* ctx) {
  * Clipboard (OSC 52)
  * ============================================================================ */
 
-void tui_clipboard_set(tui_context* ctx, const char* text) {
-    if (!ctx || !text) return;
+void tui_clipboard_set_limit(tui_context* ctx, size_t max_encoded) {
+    if (ctx) ctx->clipboard_limit = max_encoded;
+}
+
+tui_clipboard_status tui_clipboard_begin(tui_context* ctx, size_t total_len) {
+    if (!ctx) return TUI_CLIPBOARD_INVALID;
+    if (ctx->clipboard_open) return TUI_CLIPBOARD_BAD_STATE;
+    
+    size_t groups = total_len / 3 + (total_len % 3 != 0);
+    if (ctx->clipboard_limit && groups > ctx->clipboard_limit / 4) {
+        return TUI_CLIPBOARD_TOO_LARGE;
+    }
+    
+    ctx->clipboard_total = total_len;
+    ctx->clipboard_written = 0;
+    ctx->clipboard_carry_len = 0;
+    ctx->clipboard_open = true;
+    tui_output_str(ctx, "\x1b]52;c;");
+    return TUI_CLIPBOARD_OK;
+}
+
+tui_clipboard_status tui_clipboard_write(tui_context* ctx, const char* data, size_t len) {
+    if (!ctx || (!data && len)) return TUI_CLIPBOARD_INVALID;
+    if (!ctx->clipboard_open || len > ctx->clipboard_total - ctx->clipboard_written) {
+        return TUI_CLIPBOARD_BAD_STATE;
+    }
+    ctx->clipboard_written += len;
     
-    int text_len = (int)strlen(text);
-    int base64_size = ((text_len + 2) / 3) * 4 + 1;
+    const uint8_t* in = (const uint8_t*)data;
     
-    /* Limit to reasonable size */
-    if (base64_size > 65536) return;
+    /* Complete the group left over from the last write */
+    while (ctx->clipboard_carry_len > 0 && len > 0) {
+        if (ctx->clipboard_carry_len == 2) {
+            uint8_t group[3] = {ctx->clipboard_carry[0], ctx->clipboard_carry[1], *in};
+            tui_base64_stream(ctx, group, 1);
+            ctx->clipboard_carry_len = 0;
+        } else {
+            ctx->clipboard_carry[ctx->clipboard_carry_len++] = *in;
+        }
+        in++;
+        len--;
+    }
     
-    char* base64 = (char*)malloc((size_t)base64_size);
-    if (!base64) return;
+    tui_base64_stream(ctx, in, len / 3);
+    for (size_t i = len - len % 3; i < len; i++) {
+        ctx->clipboard_carry[ctx->clipboard_carry_len++] = in[i];
+    }
+    return TUI_CLIPBOARD_OK;
+}
+
+tui_clipboard_status tui_clipboard_end(tui_context* ctx) {
+    if (!ctx) return TUI_CLIPBOARD_INVALID;
+    if (!ctx->clipboard_open) return TUI_CLIPBOARD_BAD_STATE;
+    ctx->clipboard_open = false;
     
-    tui_base64_encode(text, text_len, base64, base64_size);
-    tui_ansi_set_clipboard(ctx, base64);
+    /* Padded final group */
+    if (ctx->clipboard_carry_len > 0) {
+        uint32_t v = (uint32_t)ctx->clipboard_carry[0] << 16;
+        if (ctx->clipboard_carry_len == 2) v |= (uint32_t)ctx->clipboard_carry[1] << 8;
+        char tail[4];
+        tail[0] = tui_base64_table[v >> 18];
+        tail[1] = tui_base64_table[(v >> 12) & 0x3F];
+        tail[2] = ctx->clipboard_carry_len == 2 ? tui_base64_table[(v >> 6) & 0x3F] : '=';
+        tail[3] = '=';
+        tui_output_write(ctx, tail, 4);
+    }
+    tui_output_str(ctx, "\x1b\\");
     tui_output_flush(ctx);
     
-    free(base64);
+    /* A short stream still terminates the sequence, but the copy is truncated */
+    return ctx->clipboard_written == ctx->clipboard_total ? TUI_CLIPBOARD_OK : TUI_CLIPBOARD_BAD_STATE;
+}
+
+tui_clipboard_status tui_clipboard_set_bytes(tui_context* ctx, const char* data, size_t len) {
+    if (!ctx || (!data && len)) return TUI_CLIPBOARD_INVALID;
+    tui_clipboard_status status = tui_clipboard_begin(ctx, len);
+    if (status != TUI_CLIPBOARD_OK) return status;
+    tui_clipboard_write(ctx, data, len);
+    return tui_clipboard_end(ctx);
+}
+
+tui_clipboard_status tui_clipboard_set(tui_context* ctx, const char* text) {
+    if (!ctx || !text) return TUI_CLIPBOARD_INVALID;
+    return tui_clipboard_set_bytes(ctx, text, strlen(text));
 }
 
 /* ============================================================================
  * Hyperlinks (OSC 8)
  * ============================================================================ */
 
-void tui_hyperlink_start(tui_context* ctx, const char* url) {
-    if (ctx && url) {
-        tui_ansi_hyperlink_start(ctx, url);
+static uint32_t tui_fnv1a(const char* data, size_t len) {
+    uint32_t h = 2166136261u;
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
     }
+    return h;
 }
 
-void tui_hyperlink_end(tui_context* ctx) {
+static uint32_t tui_link_hash(const char* url) {
+    return tui_fnv1a(url, strlen(url));
+}
+
+static bool tui_link_rehash(tui_context* ctx, int slot_count) {
+    uint16_t* slots = (uint16_t*)calloc((size_t)slot_count, sizeof(uint16_t));
+    if (!slots) return false;
+    for (int id = 1; id <= ctx->link_count; id++) {
+        uint32_t i = tui_link_hash(ctx->links[id - 1]) & (uint32_t)(slot_count - 1);
+        while (slots[i]) i = (i + 1) & (uint32_t)(slot_count - 1);
+        slots[i] = (uint16_t)id;
+    }
+    free(ctx->link_slots);
+    ctx->link_slots = slots;
+    ctx->link_slot_count = slot_count;
+    return true;
+}
+
+/* ID of a URL, interning it on first use (0 when the table is full) */
+static uint16_t tui_link_intern(tui_context* ctx, const char* url) {
+    if (ctx->link_slot_count) {
+        uint32_t mask = (uint32_t)(ctx->link_slot_count - 1);
+        for (uint32_t i = tui_link_hash(url) & mask; ctx->link_slots[i]; i = (i + 1) & mask) {
+            uint16_t id = ctx->link_slots[i];
+            if (strcmp(ctx->links[id - 1], url) == 0) return id;
+        }
+    }
+    if (ctx->link_count >= TUI_MAX_LINKS) return 0;
+    
+    /* Keep the index at most half full */
+    if ((ctx->link_count + 1) * 2 > ctx->link_slot_count) {
+        if (!tui_link_rehash(ctx, ctx->link_slot_count ? ctx->link_slot_count * 2 : 64)) return 0;
+    }
+    if (ctx->link_count >= ctx->link_capacity) {
+        int cap = ctx->link_capacity ? ctx->link_capacity * 2 : 32;
+        char** links = (char**)realloc(ctx->links, (size_t)cap * sizeof(char*));
+        if (!links) return 0;
+        ctx->links = links;
+        ctx->link_capacity = cap;
+    }
+    
+    size_t len = strlen(url);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return 0;
+    memcpy(copy, url, len + 1);
+    ctx->links[ctx->link_count++] = copy;
+    
+    uint16_t id = (uint16_t)ctx->link_count;
+    uint32_t mask = (uint32_t)(ctx->link_slot_count - 1);
+    uint32_t i = tui_link_hash(url) & mask;
+    while (ctx->link_slots[i]) i = (i + 1) & mask;
+    ctx->link_slots[i] = id;
+    return id;
+}
+
+void tui_hyperlink_start(tui_context* ctx, const char* url) {
+    if (ctx && url) {
+        ctx->current_link = tui_link_intern(ctx, url);
+    }
+}
+
+void tui_hyperlink_end(tui_context* ctx) {
     if (ctx) {
-        tui_ansi_hyperlink_end(ctx);
+        ctx->current_link = 0;
+    }
+}
+
+void tui_hyperlink_reset(tui_context* ctx) {
+    if (!ctx) return;
+    for (int i = 0; i < ctx->link_count; i++) {
+        free(ctx->links[i]);
+    }
+    ctx->link_count = 0;
+    if (ctx->link_slots) memset(ctx->link_slots, 0, (size_t)ctx->link_slot_count * sizeof(uint16_t));
+    ctx->current_link = 0;
+    
+    /* IDs on screen no longer mean anything */
+    ctx->needs_redraw = true;
+    if (ctx->in_frame) {
+        for (int y = 0; y < ctx->height; y++) {
+            for (int x = 0; x < ctx->width; x++) {
+                ctx->back_buffer[y * TUI_MAX_WIDTH + x].link = 0;
+            }
+        }
     }
 }
 
@@ -2325,7 +3413,7 @@ void tui_hyperlink_end(tui_context* ctx) {
 
 void tui_set_cell_wide(tui_context* ctx, int x, int y, uint32_t codepoint) {
     if (!ctx || !ctx->in_frame) return;
-    if (x < 0 || x >= ctx->width - 1 || y < 0 || y >= ctx->height) return;
+    if (x < ctx->clip_x0 || x >= ctx->clip_x1 - 1 || y < ctx->clip_y0 || y >= ctx->clip_y1) return;
     
     /* Set the wide character in first cell */
     int idx = y * TUI_MAX_WIDTH + x;
@@ -2334,6 +3422,7 @@ void tui_set_cell_wide(tui_context* ctx, int x, int y, uint32_t codepoint) {
     ctx->back_buffer[idx].bg = ctx->current_bg;
     ctx->back_buffer[idx].underline_color = ctx->current_underline_color;
     ctx->back_buffer[idx].style = ctx->current_style;
+    ctx->back_buffer[idx].link = ctx->current_link;
     
     /* Set second cell as a continuation marker (space with same bg) */
     int idx2 = y * TUI_MAX_WIDTH + x + 1;
@@ -2342,6 +3431,7 @@ void tui_set_cell_wide(tui_context* ctx, int x, int y, uint32_t codepoint) {
     ctx->back_buffer[idx2].bg = ctx->current_bg;
     ctx->back_buffer[idx2].underline_color = ctx->current_underline_color;
     ctx->back_buffer[idx2].style = ctx->current_style;
+    ctx->back_buffer[idx2].link = ctx->current_link;
 }
 
 /* ============================================================================
@@ -2472,6 +3562,219 @@ void tui_label_aligned(tui_context* ctx, int x, int y, int width, const char* te
     tui_label(ctx, x + offset, y, text);
 }
 
+/* ============================================================================
+ * Interned Strings
+ * ============================================================================ */
+
+typedef struct {
+    const char* text;           /* In one of the table's blocks */
+    int len;
+    int width;
+    uint32_t hash;
+    bool ascii;
+} tui_str_entry;
+
+struct tui_strings {
+    tui_str_entry* entries;     /* Handle - 1 */
+    int count;
+    int capacity;
+    tui_str* slots;             /* Open-addressed index, power of two */
+    int slot_count;
+    char** blocks;              /* Text storage; never moved, so pointers stay valid */
+    int block_count;
+    int block_capacity;
+    size_t block_used;          /* Bytes used in the last block */
+    size_t block_size;
+};
+
+tui_strings* tui_strings_create(void) {
+    return (tui_strings*)calloc(1, sizeof(tui_strings));
+}
+
+void tui_strings_destroy(tui_strings* table) {
+    if (!table) return;
+    for (int i = 0; i < table->block_count; i++) {
+        free(table->blocks[i]);
+    }
+    free(table->blocks);
+    free(table->entries);
+    free(table->slots);
+    free(table);
+}
+
+static bool tui_strings_rehash(tui_strings* table, int slot_count) {
+    tui_str* slots = (tui_str*)calloc((size_t)slot_count, sizeof(tui_str));
+    if (!slots) return false;
+    uint32_t mask = (uint32_t)(slot_count - 1);
+    for (int i = 0; i < table->count; i++) {
+        uint32_t j = table->entries[i].hash & mask;
+        while (slots[j]) j = (j + 1) & mask;
+        slots[j] = (tui_str)(i + 1);
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return true;
+}
+
+/* Copy len bytes plus a terminator into block storage */
+static const char* tui_strings_store(tui_strings* table, const char* text, int len) {
+    size_t need = (size_t)len + 1;
+    if (table->block_count == 0 || table->block_used + need > table->block_size) {
+        if (table->block_count >= table->block_capacity) {
+            int cap = table->block_capacity ? table->block_capacity * 2 : 8;
+            char** blocks = (char**)realloc(table->blocks, (size_t)cap * sizeof(char*));
+            if (!blocks) return NULL;
+            table->blocks = blocks;
+            table->block_capacity = cap;
+        }
+        size_t size = need > TUI_STRINGS_BLOCK_SIZE ? need : TUI_STRINGS_BLOCK_SIZE;
+        char* block = (char*)malloc(size);
+        if (!block) return NULL;
+        table->blocks[table->block_count++] = block;
+        table->block_used = 0;
+        table->block_size = size;
+    }
+    
+    char* dst = table->blocks[table->block_count - 1] + table->block_used;
+    memcpy(dst, text, (size_t)len);
+    dst[len] = '\0';
+    table->block_used += need;
+    return dst;
+}
+
+tui_str tui_str_intern_n(tui_strings* table, const char* text, int len) {
+    if (!table || !text || len < 0) return 0;
+    uint32_t hash = tui_fnv1a(text, (size_t)len);
+    
+    if (table->slot_count) {
+        uint32_t mask = (uint32_t)(table->slot_count - 1);
+        for (uint32_t i = hash & mask; table->slots[i]; i = (i + 1) & mask) {
+            const tui_str_entry* e = &table->entries[table->slots[i] - 1];
+            if (e->hash == hash && e->len == len && memcmp(e->text, text, (size_t)len) == 0) {
+                return table->slots[i];
+            }
+        }
+    }
+    
+    /* Keep the index at most half full */
+    if ((table->count + 1) * 2 > table->slot_count) {
+        if (!tui_strings_rehash(table, table->slot_count ? table->slot_count * 2 : 64)) return 0;
+    }
+    if (table->count >= table->capacity) {
+        int cap = table->capacity ? table->capacity * 2 : 64;
+        tui_str_entry* entries = (tui_str_entry*)realloc(table->entries, (size_t)cap * sizeof(tui_str_entry));
+        if (!entries) return 0;
+        table->entries = entries;
+        table->capacity = cap;
+    }
+    
+    const char* copy = tui_strings_store(table, text, len);
+    if (!copy) return 0;
+    
+    /* Measure once, the way tui_label advances */
+    tui_str_entry* e = &table->entries[table->count];
+    e->text = copy;
+    e->len = len;
+    e->hash = hash;
+    e->ascii = true;
+    e->width = 0;
+    const uint8_t* p = (const uint8_t*)copy;
+    for (int pos = 0; pos < len;) {
+        if (p[pos] >= 32 && p[pos] < 127) {
+            e->width++;
+            pos++;
+            continue;
+        }
+        uint32_t cp;
+        e->ascii = false;
+        pos += tui_utf8_decode(p + pos, len - pos, &cp);
+        if (cp >= 32) e->width += tui_char_width(cp);
+    }
+    
+    tui_str id = (tui_str)++table->count;
+    uint32_t mask = (uint32_t)(table->slot_count - 1);
+    uint32_t i = hash & mask;
+    while (table->slots[i]) i = (i + 1) & mask;
+    table->slots[i] = id;
+    return id;
+}
+
+tui_str tui_str_intern(tui_strings* table, const char* text) {
+    if (!text) return 0;
+    return tui_str_intern_n(table, text, (int)strlen(text));
+}
+
+static const tui_str_entry* tui_str_entry_get(const tui_strings* table, tui_str s) {
+    if (!table || s == 0 || s > (tui_str)table->count) return NULL;
+    return &table->entries[s - 1];
+}
+
+const char* tui_str_text(const tui_strings* table, tui_str s) {
+    const tui_str_entry* e = tui_str_entry_get(table, s);
+    return e ? e->text : "";
+}
+
+int tui_str_len(const tui_strings* table, tui_str s) {
+    const tui_str_entry* e = tui_str_entry_get(table, s);
+    return e ? e->len : 0;
+}
+
+int tui_str_width(const tui_strings* table, tui_str s) {
+    const tui_str_entry* e = tui_str_entry_get(table, s);
+    return e ? e->width : 0;
+}
+
+bool tui_str_is_ascii(const tui_strings* table, tui_str s) {
+    const tui_str_entry* e = tui_str_entry_get(table, s);
+    return e ? e->ascii : true;
+}
+
+void tui_set_strings(tui_context* ctx, tui_strings* table) {
+    if (ctx) ctx->strings = table;
+}
+
+void tui_label_str(tui_context* ctx, int x, int y, tui_str s) {
+    if (!ctx || !ctx->in_frame) return;
+    const tui_str_entry* e = tui_str_entry_get(ctx->strings, s);
+    if (!e) return;
+    if (!e->ascii) {
+        tui_label(ctx, x, y, e->text);
+        return;
+    }
+    
+    /* Printable ASCII: one byte per cell, clipped once for the whole run */
+    if (y < ctx->clip_y0 || y >= ctx->clip_y1) return;
+    int from = x < ctx->clip_x0 ? ctx->clip_x0 - x : 0;
+    int to = x + e->len > ctx->clip_x1 ? ctx->clip_x1 - x : e->len;
+    
+    tui_cell cell = tui_make_empty_cell();
+    cell.fg = ctx->current_fg;
+    cell.bg = ctx->current_bg;
+    cell.underline_color = ctx->current_underline_color;
+    cell.style = ctx->current_style;
+    cell.link = ctx->current_link;
+    tui_cell* row = &ctx->back_buffer[y * TUI_MAX_WIDTH];
+    for (int i = from; i < to; i++) {
+        cell.codepoint = (uint8_t)e->text[i];
+        row[x + i] = cell;
+    }
+}
+
+#ifndef TUI_NO_WIDGETS
+/* Aligned like tui_label_aligned, using the stored width */
+static void tui_label_str_aligned(tui_context* ctx, int x, int y, int width, tui_str s, tui_align align) {
+    int text_w = tui_str_width(ctx->strings, s);
+    int offset = 0;
+    if (align == TUI_ALIGN_CENTER) offset = (width - text_w) / 2;
+    else if (align == TUI_ALIGN_RIGHT) offset = width - text_w;
+    if (offset < 0) offset = 0;
+    
+    tui_fill(ctx, x, y, width, 1, ' ');
+    tui_label_str(ctx, x + offset, y, s);
+}
+#endif
+
 /* ============================================================================
  * Popup/Modal Widget
  * ============================================================================ */
@@ -2480,15 +3783,9 @@ void tui_popup_box(tui_context* ctx, int x, int y, int w, int h, const char* tit
                    tui_border_style style) {
     if (!ctx || !ctx->in_frame || w < 4 || h < 3) return;
     
-    uint32_t save_fg = ctx->current_fg;
-    uint32_t save_bg = ctx->current_bg;
-    
-    /* Fill background */
-    ctx->current_bg = TUI_RGB(30, 30, 30);
+    /* Fill background and draw border */
+    tui_push_token(ctx, TUI_TOKEN_POPUP);
     tui_fill(ctx, x + 1, y + 1, w - 2, h - 2, ' ');
-    
-    /* Draw border */
-    ctx->current_fg = TUI_COLOR_WHITE;
     tui_box(ctx, x, y, w, h, style);
     
     /* Draw title if provided */
@@ -2496,15 +3793,87 @@ void tui_popup_box(tui_context* ctx, int x, int y, int w, int h, const char* tit
         int title_len = tui_text_width(title);
         int title_x = x + (w - title_len - 2) / 2;
         
-        ctx->current_fg = TUI_COLOR_YELLOW;
-        ctx->current_bg = TUI_RGB(30, 30, 30);
+        tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_POPUP_TITLE]);
         tui_set_cell(ctx, title_x, y, ' ');
         tui_label(ctx, title_x + 1, y, title);
         tui_set_cell(ctx, title_x + title_len + 1, y, ' ');
     }
     
-    ctx->current_fg = save_fg;
-    ctx->current_bg = save_bg;
+    tui_pop_style(ctx);
+}
+
+/* ============================================================================
+ * Save-Under
+ * ============================================================================ */
+
+int tui_save_under(tui_context* ctx, int x, int y, int w, int h) {
+    if (!ctx || !ctx->in_frame) return -1;
+    
+    /* Clip to the screen */
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > ctx->width) w = ctx->width - x;
+    if (y + h > ctx->height) h = ctx->height - y;
+    if (w <= 0 || h <= 0) return -1;
+    
+    /* Prefer a released slot whose buffer is already big enough */
+    int id = -1;
+    for (int i = 0; i < TUI_SAVE_UNDER_SLOTS; i++) {
+        tui_save_slot* slot = &ctx->save_under[i];
+        if (slot->used) continue;
+        if (id < 0 || (slot->capacity >= w * h && ctx->save_under[id].capacity < w * h)) id = i;
+    }
+    if (id < 0) return -1;
+    
+    tui_save_slot* slot = &ctx->save_under[id];
+    if (slot->capacity < w * h) {
+        tui_cell* cells = (tui_cell*)realloc(slot->cells, (size_t)(w * h) * sizeof(tui_cell));
+        if (!cells) return -1;
+        slot->cells = cells;
+        slot->capacity = w * h;
+    }
+    
+    for (int row = 0; row < h; row++) {
+        memcpy(&slot->cells[row * w], &ctx->back_buffer[(y + row) * TUI_MAX_WIDTH + x],
+               (size_t)w * sizeof(tui_cell));
+    }
+    slot->x = x;
+    slot->y = y;
+    slot->w = w;
+    slot->h = h;
+    slot->used = true;
+    slot->valid = true;
+    return id;
+}
+
+bool tui_restore_under(tui_context* ctx, int id) {
+    if (!ctx || !ctx->in_frame || id < 0 || id >= TUI_SAVE_UNDER_SLOTS) return false;
+    tui_save_slot* slot = &ctx->save_under[id];
+    if (!slot->used) return false;
+    slot->used = false;
+    if (!slot->valid) return false;
+    
+    for (int row = 0; row < slot->h; row++) {
+        memcpy(&ctx->back_buffer[(slot->y + row) * TUI_MAX_WIDTH + slot->x],
+               &slot->cells[row * slot->w], (size_t)slot->w * sizeof(tui_cell));
+    }
+    return true;
+}
+
+void tui_discard_under(tui_context* ctx, int id) {
+    if (!ctx || id < 0 || id >= TUI_SAVE_UNDER_SLOTS) return;
+    ctx->save_under[id].used = false;
+}
+
+void tui_invalidate_under(tui_context* ctx, int x, int y, int w, int h) {
+    if (!ctx) return;
+    for (int i = 0; i < TUI_SAVE_UNDER_SLOTS; i++) {
+        tui_save_slot* slot = &ctx->save_under[i];
+        if (slot->used && x < slot->x + slot->w && slot->x < x + w &&
+            y < slot->y + slot->h && slot->y < y + h) {
+            slot->valid = false;
+        }
+    }
 }
 
 /* ============================================================================
@@ -2543,6 +3912,588 @@ int tui_wrap_text(tui_context* ctx, int x, int y, int width, int max_lines, cons
     return line + 1;
 }
 
+/* ============================================================================
+ * Pixel Canvas
+ * ============================================================================ */
+
+/* Pixels are stored packed per cell: one Braille dot bit per pixel, or bit 0
+ * (top) / bit 1 (bottom) for half blocks. Cells whose bits or colors change
+ * are flagged and re-encoded to a cached tui_cell on the next draw, so a
+ * frame only pays the glyph math for what changed and blits the rest. */
+struct tui_canvas {
+    tui_canvas_mode mode;
+    int cols, rows;         /* Size in cells */
+    int width, height;      /* Size in pixels */
+    uint8_t* bits;          /* Pixel bits per cell */
+    uint32_t* color;        /* Dot color (Braille) or top pixel color */
+    uint32_t* color2;       /* Bottom pixel color (half blocks) */
+    uint8_t* dirty;         /* Cell needs re-encoding */
+    int dirty_count;
+    uint8_t* prev_bits;     /* Previous frame while re-rendering (see tui_canvas_rerender_begin) */
+    uint32_t* prev_color;
+    uint32_t* prev_color2;
+    bool rerendering;       /* Defer dirty marking to tui_canvas_rerender_end */
+    tui_cell* cells;        /* Encoded cells */
+    uint32_t pen;
+    uint32_t bg;
+};
+
+/* Braille dot bit for pixel (column, row) within a 2x4 cell */
+static const uint8_t tui_braille_bits[4][2] = {
+    {0x01, 0x08}, {0x02, 0x10}, {0x04, 0x20}, {0x40, 0x80}
+};
+
+static bool tui_canvas_alloc(tui_canvas* canvas, int cols, int rows) {
+    size_t n = (size_t)cols * (size_t)rows;
+    uint8_t* bits = (uint8_t*)calloc(n ? n : 1, 3);     /* bits, dirty flags, previous bits */
+    uint32_t* colors = (uint32_t*)malloc((n ? n : 1) * 4 * sizeof(uint32_t));
+    tui_cell* cells = (tui_cell*)malloc((n ? n : 1) * sizeof(tui_cell));
+    if (!bits || !colors || !cells) {
+        free(bits);
+        free(colors);
+        free(cells);
+        return false;
+    }
+    
+    free(canvas->bits);
+    free(canvas->color);
+    free(canvas->cells);
+    canvas->bits = bits;
+    canvas->dirty = bits + n;
+    canvas->prev_bits = bits + 2 * n;
+    canvas->color = colors;
+    canvas->color2 = colors + n;
+    canvas->prev_color = colors + 2 * n;
+    canvas->prev_color2 = colors + 3 * n;
+    canvas->cells = cells;
+    canvas->cols = cols;
+    canvas->rows = rows;
+    canvas->width = cols * (canvas->mode == TUI_CANVAS_BRAILLE ? 2 : 1);
+    canvas->height = rows * (canvas->mode == TUI_CANVAS_BRAILLE ? 4 : 2);
+    
+    for (size_t i = 0; i < n; i++) {
+        colors[i] = colors[n + i] = canvas->pen;
+        canvas->dirty[i] = 1;
+    }
+    canvas->dirty_count = (int)n;
+    return true;
+}
+
+tui_canvas* tui_canvas_create(int cols, int rows, tui_canvas_mode mode) {
+    if (cols < 0 || rows < 0) return NULL;
+    tui_canvas* canvas = (tui_canvas*)calloc(1, sizeof(tui_canvas));
+    if (!canvas) return NULL;
+    
+    canvas->mode = mode;
+    canvas->pen = TUI_COLOR_WHITE;
+    canvas->bg = TUI_COLOR_DEFAULT;
+    if (!tui_canvas_alloc(canvas, cols, rows)) {
+        free(canvas);
+        return NULL;
+    }
+    return canvas;
+}
+
+void tui_canvas_destroy(tui_canvas* canvas) {
+    if (!canvas) return;
+    free(canvas->bits);
+    free(canvas->color);
+    free(canvas->cells);
+    free(canvas);
+}
+
+bool tui_canvas_resize(tui_canvas* canvas, int cols, int rows) {
+    if (!canvas || cols < 0 || rows < 0) return false;
+    if (cols == canvas->cols && rows == canvas->rows) return true;
+    return tui_canvas_alloc(canvas, cols, rows);
+}
+
+int tui_canvas_width(const tui_canvas* canvas) {
+    return canvas ? canvas->width : 0;
+}
+
+int tui_canvas_height(const tui_canvas* canvas) {
+    return canvas ? canvas->height : 0;
+}
+
+static void tui_canvas_mark(tui_canvas* canvas, int idx) {
+    if (!canvas->rerendering && !canvas->dirty[idx]) {
+        canvas->dirty[idx] = 1;
+        canvas->dirty_count++;
+    }
+}
+
+void tui_canvas_clear(tui_canvas* canvas) {
+    if (!canvas) return;
+    int n = canvas->cols * canvas->rows;
+    for (int i = 0; i < n; i++) {
+        if (canvas->bits[i]) {
+            canvas->bits[i] = 0;
+            tui_canvas_mark(canvas, i);
+        }
+    }
+}
+
+#ifndef TUI_NO_WIDGETS
+/* Redraw the whole canvas from scratch without re-encoding it all: the
+ * current pixels are kept aside and cleared, and once the new ones are
+ * plotted tui_canvas_rerender_end marks only the cells that differ */
+static void tui_canvas_rerender_begin(tui_canvas* canvas) {
+    size_t n = (size_t)canvas->cols * (size_t)canvas->rows;
+    memcpy(canvas->prev_bits, canvas->bits, n);
+    memcpy(canvas->prev_color, canvas->color, n * sizeof(uint32_t));
+    memcpy(canvas->prev_color2, canvas->color2, n * sizeof(uint32_t));
+    memset(canvas->bits, 0, n);
+    canvas->rerendering = true;
+}
+
+static void tui_canvas_rerender_end(tui_canvas* canvas) {
+    int n = canvas->cols * canvas->rows;
+    canvas->rerendering = false;
+    for (int i = 0; i < n; i++) {
+        if (canvas->bits[i] != canvas->prev_bits[i] ||
+            (canvas->bits[i] && (canvas->color[i] != canvas->prev_color[i] ||
+                                 canvas->color2[i] != canvas->prev_color2[i]))) {
+            tui_canvas_mark(canvas, i);
+        }
+    }
+}
+#endif
+
+void tui_canvas_set_color(tui_canvas* canvas, uint32_t color) {
+    if (canvas) canvas->pen = color;
+}
+
+void tui_canvas_set_bg(tui_canvas* canvas, uint32_t color) {
+    if (!canvas || canvas->bg == color) return;
+    canvas->bg = color;
+    int n = canvas->cols * canvas->rows;
+    for (int i = 0; i < n; i++) tui_canvas_mark(canvas, i);
+}
+
+/* Turn on `mask` in cell idx with the pen color */
+static void tui_canvas_apply(tui_canvas* canvas, int idx, uint8_t mask) {
+    uint32_t pen = canvas->pen;
+    bool changed = (canvas->bits[idx] & mask) != mask;
+    
+    if (canvas->mode == TUI_CANVAS_BRAILLE || (mask & 1)) {
+        changed |= canvas->color[idx] != pen;
+        canvas->color[idx] = pen;
+    }
+    if (canvas->mode == TUI_CANVAS_HALFBLOCK && (mask & 2)) {
+        changed |= canvas->color2[idx] != pen;
+        canvas->color2[idx] = pen;
+    }
+    canvas->bits[idx] |= mask;
+    if (changed) tui_canvas_mark(canvas, idx);
+}
+
+static void tui_canvas_plot(tui_canvas* canvas, int x, int y) {
+    if ((unsigned)x >= (unsigned)canvas->width || (unsigned)y >= (unsigned)canvas->height) return;
+    if (canvas->mode == TUI_CANVAS_BRAILLE) {
+        tui_canvas_apply(canvas, (y >> 2) * canvas->cols + (x >> 1), tui_braille_bits[y & 3][x & 1]);
+    } else {
+        tui_canvas_apply(canvas, (y >> 1) * canvas->cols + x, (uint8_t)(1 << (y & 1)));
+    }
+}
+
+void tui_canvas_set(tui_canvas* canvas, int x, int y, bool on) {
+    if (!canvas) return;
+    if (on) {
+        tui_canvas_plot(canvas, x, y);
+        return;
+    }
+    if ((unsigned)x >= (unsigned)canvas->width || (unsigned)y >= (unsigned)canvas->height) return;
+    
+    int idx;
+    uint8_t bit;
+    if (canvas->mode == TUI_CANVAS_BRAILLE) {
+        idx = (y >> 2) * canvas->cols + (x >> 1);
+        bit = tui_braille_bits[y & 3][x & 1];
+    } else {
+        idx = (y >> 1) * canvas->cols + x;
+        bit = (uint8_t)(1 << (y & 1));
+    }
+    if (canvas->bits[idx] & bit) {
+        canvas->bits[idx] &= (uint8_t)~bit;
+        tui_canvas_mark(canvas, idx);
+    }
+}
+
+bool tui_canvas_get(const tui_canvas* canvas, int x, int y) {
+    if (!canvas || (unsigned)x >= (unsigned)canvas->width || (unsigned)y >= (unsigned)canvas->height) return false;
+    if (canvas->mode == TUI_CANVAS_BRAILLE) {
+        return (canvas->bits[(y >> 2) * canvas->cols + (x >> 1)] & tui_braille_bits[y & 3][x & 1]) != 0;
+    }
+    return (canvas->bits[(y >> 1) * canvas->cols + x] & (1 << (y & 1))) != 0;
+}
+
+/* Fill the pixel rectangle [x0, x1] x [y0, y1] a whole cell at a time: the
+ * covered dots of each cell are combined into one mask and OR-ed in once */
+static void tui_canvas_fill(tui_canvas* canvas, int x0, int y0, int x1, int y1) {
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= canvas->width) x1 = canvas->width - 1;
+    if (y1 >= canvas->height) y1 = canvas->height - 1;
+    if (x0 > x1 || y0 > y1) return;
+    
+    bool braille = canvas->mode == TUI_CANVAS_BRAILLE;
+    int cw = braille ? 2 : 1;
+    int ch = braille ? 4 : 2;
+    
+    for (int cy = y0 / ch; cy <= y1 / ch; cy++) {
+        int r0 = (y0 > cy * ch ? y0 : cy * ch) - cy * ch;
+        int r1 = (y1 < cy * ch + ch - 1 ? y1 : cy * ch + ch - 1) - cy * ch;
+        
+        /* Dots covered in each column of a cell on this row */
+        uint8_t col_mask[2] = {0, 0};
+        for (int r = r0; r <= r1; r++) {
+            if (braille) {
+                col_mask[0] |= tui_braille_bits[r][0];
+                col_mask[1] |= tui_braille_bits[r][1];
+            } else {
+                col_mask[0] |= (uint8_t)(1 << r);
+            }
+        }
+        
+        int first = x0 / cw;
+        int last = x1 / cw;
+        for (int cx = first; cx <= last; cx++) {
+            uint8_t mask = col_mask[0] | col_mask[1];
+            if (braille) {
+                if (cx == first && (x0 & 1)) mask = col_mask[1];
+                if (cx == last && !(x1 & 1)) mask &= col_mask[0];
+            }
+            tui_canvas_apply(canvas, cy * canvas->cols + cx, mask);
+        }
+    }
+}
+
+void tui_canvas_line(tui_canvas* canvas, int x0, int y0, int x1, int y1) {
+    if (!canvas) return;
+    
+    /* Axis-aligned lines are spans */
+    if (y0 == y1 || x0 == x1) {
+        tui_canvas_fill(canvas, x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+                        x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0);
+        return;
+    }
+    
+    /* Reject lines entirely off one side */
+    if ((x0 < 0 && x1 < 0) || (y0 < 0 && y1 < 0) ||
+        (x0 >= canvas->width && x1 >= canvas->width) ||
+        (y0 >= canvas->height && y1 >= canvas->height)) return;
+    
+    /* Bresenham */
+    int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int dy = y1 > y0 ? y0 - y1 : y1 - y0;
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    
+    while (true) {
+        tui_canvas_plot(canvas, x0, y0);
+        if (x0 == x1 && y0 == y1) break;
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void tui_canvas_rect(tui_canvas* canvas, int x, int y, int w, int h, bool filled) {
+    if (!canvas || w <= 0 || h <= 0) return;
+    if (filled) {
+        tui_canvas_fill(canvas, x, y, x + w - 1, y + h - 1);
+        return;
+    }
+    tui_canvas_fill(canvas, x, y, x + w - 1, y);
+    tui_canvas_fill(canvas, x, y + h - 1, x + w - 1, y + h - 1);
+    tui_canvas_fill(canvas, x, y, x, y + h - 1);
+    tui_canvas_fill(canvas, x + w - 1, y, x + w - 1, y + h - 1);
+}
+
+void tui_canvas_polyline(tui_canvas* canvas, const int* points, int count) {
+    if (!canvas || !points) return;
+    if (count == 1) tui_canvas_plot(canvas, points[0], points[1]);
+    for (int i = 1; i < count; i++) {
+        tui_canvas_line(canvas, points[2 * i - 2], points[2 * i - 1], points[2 * i], points[2 * i + 1]);
+    }
+}
+
+static void tui_canvas_encode(const tui_canvas* canvas, int idx, tui_cell* cell) {
+    uint8_t bits = canvas->bits[idx];
+    memset(cell, 0, sizeof(*cell));
+    cell->codepoint = ' ';
+    cell->fg = canvas->color[idx];
+    cell->bg = canvas->bg;
+    cell->underline_color = TUI_COLOR_DEFAULT;
+    cell->style = TUI_STYLE_NONE;
+    
+    if (canvas->mode == TUI_CANVAS_BRAILLE) {
+        if (bits) cell->codepoint = 0x2800 + bits;
+    } else if (bits == 1) {
+        cell->codepoint = 0x2580;  /* ▀ */
+    } else if (bits == 2) {
+        cell->codepoint = 0x2584;  /* ▄ */
+        cell->fg = canvas->color2[idx];
+    } else if (bits == 3) {
+        cell->codepoint = 0x2580;
+        cell->bg = canvas->color2[idx];
+    }
+}
+
+void tui_canvas_draw(tui_context* ctx, tui_canvas* canvas, int x, int y) {
+    if (!ctx || !ctx->in_frame || !canvas) return;
+    
+    /* Re-encode only the cells that changed since the last draw */
+    if (canvas->dirty_count > 0) {
+        int n = canvas->cols * canvas->rows;
+        for (int i = 0; i < n; i++) {
+            if (canvas->dirty[i]) {
+                tui_canvas_encode(canvas, i, &canvas->cells[i]);
+                canvas->dirty[i] = 0;
+            }
+        }
+        canvas->dirty_count = 0;
+    }
+    
+    /* Blit whole clipped rows */
+    int c0 = x < ctx->clip_x0 ? ctx->clip_x0 - x : 0;
+    int c1 = x + canvas->cols > ctx->clip_x1 ? ctx->clip_x1 - x : canvas->cols;
+    if (c0 >= c1) return;
+    for (int r = 0; r < canvas->rows; r++) {
+        int sy = y + r;
+        if (sy < ctx->clip_y0 || sy >= ctx->clip_y1) continue;
+        memcpy(&ctx->back_buffer[sy * TUI_MAX_WIDTH + x + c0], &canvas->cells[r * canvas->cols + c0],
+               (size_t)(c1 - c0) * sizeof(tui_cell));
+    }
+}
+
+/* ============================================================================
+ * Numeric Series
+ * ============================================================================ */
+
+/* Min/max summaries of one level: entry i covers values
+ * [i * FANOUT^k, (i + 1) * FANOUT^k) for level k >= 1 */
+typedef struct {
+    float* min;
+    float* max;
+    int count;
+    int capacity;
+} tui_series_level;
+
+/* Raw values plus a pyramid of summaries. A summary is written once, when
+ * its block completes, from the FANOUT entries below it, so appending costs
+ * amortized O(1). A range query takes whole blocks from the coarsest level
+ * that fits and only touches finer levels at the unaligned ends. */
+struct tui_series {
+    float* values;
+    int count;
+    int capacity;
+    unsigned version;       /* Bumped on every change */
+    tui_series_level levels[TUI_SERIES_MAX_LEVELS];  /* levels[k] is level k + 1 */
+    int level_count;
+};
+
+tui_series* tui_series_create(void) {
+    return (tui_series*)calloc(1, sizeof(tui_series));
+}
+
+void tui_series_destroy(tui_series* s) {
+    if (!s) return;
+    free(s->values);
+    for (int k = 0; k < TUI_SERIES_MAX_LEVELS; k++) {
+        free(s->levels[k].min);
+        free(s->levels[k].max);
+    }
+    free(s);
+}
+
+void tui_series_clear(tui_series* s) {
+    if (!s) return;
+    s->count = 0;
+    s->version++;
+    for (int k = 0; k < s->level_count; k++) s->levels[k].count = 0;
+    s->level_count = 0;
+}
+
+int tui_series_count(const tui_series* s) {
+    return s ? s->count : 0;
+}
+
+float tui_series_get(const tui_series* s, int index) {
+    if (!s || index < 0 || index >= s->count) return 0.0f;
+    return s->values[index];
+}
+
+static bool tui_series_level_reserve(tui_series_level* level, int count) {
+    if (count <= level->capacity) return true;
+    int cap = level->capacity ? level->capacity * 2 : 64;
+    float* min = (float*)realloc(level->min, (size_t)cap * sizeof(float));
+    if (!min) return false;
+    level->min = min;
+    float* max = (float*)realloc(level->max, (size_t)cap * sizeof(float));
+    if (!max) return false;
+    level->max = max;
+    level->capacity = cap;
+    return true;
+}
+
+bool tui_series_push(tui_series* s, float value) {
+    if (!s) return false;
+    if (s->count == s->capacity) {
+        int cap = s->capacity ? s->capacity * 2 : 256;
+        float* values = (float*)realloc(s->values, (size_t)cap * sizeof(float));
+        if (!values) return false;
+        s->values = values;
+        s->capacity = cap;
+    }
+    s->values[s->count++] = value;
+    s->version++;
+    
+    /* Summarize every block this value completed, bottom up */
+    int blocks = s->count;
+    for (int k = 0; k < TUI_SERIES_MAX_LEVELS && blocks % TUI_SERIES_FANOUT == 0; k++) {
+        blocks /= TUI_SERIES_FANOUT;
+        tui_series_level* level = &s->levels[k];
+        if (!tui_series_level_reserve(level, blocks)) break;
+        
+        int first = (blocks - 1) * TUI_SERIES_FANOUT;
+        const float* lo = k == 0 ? s->values + first : s->levels[k - 1].min + first;
+        const float* hi = k == 0 ? s->values + first : s->levels[k - 1].max + first;
+        float mn = lo[0];
+        float mx = hi[0];
+        for (int i = 1; i < TUI_SERIES_FANOUT; i++) {
+            if (lo[i] < mn) mn = lo[i];
+            if (hi[i] > mx) mx = hi[i];
+        }
+        level->min[blocks - 1] = mn;
+        level->max[blocks - 1] = mx;
+        level->count = blocks;
+        if (k + 1 > s->level_count) s->level_count = k + 1;
+    }
+    return true;
+}
+
+/* Fold entry idx of level k into [*lo, *hi] */
+static void tui_series_take(const tui_series* s, int k, int idx, float* lo, float* hi) {
+    float mn = k == 0 ? s->values[idx] : s->levels[k - 1].min[idx];
+    float mx = k == 0 ? s->values[idx] : s->levels[k - 1].max[idx];
+    if (mn < *lo) *lo = mn;
+    if (mx > *hi) *hi = mx;
+}
+
+bool tui_series_range(const tui_series* s, int start, int end, float* min, float* max) {
+    if (!s) return false;
+    if (start < 0) start = 0;
+    if (end > s->count) end = s->count;
+    if (start >= end) return false;
+    
+    float lo = s->values[start];
+    float hi = lo;
+    int a = start;
+    int b = end;
+    int k = 0;
+    int size = 1;       /* Values per entry at level k */
+    
+    while (a < b) {
+        if (k < s->level_count) {
+            /* Walk both ends up to the next level's alignment, then climb */
+            int next = size * TUI_SERIES_FANOUT;
+            while (a < b && a % next) {
+                tui_series_take(s, k, a / size, &lo, &hi);
+                a += size;
+            }
+            while (b > a && b % next) {
+                b -= size;
+                tui_series_take(s, k, b / size, &lo, &hi);
+            }
+            k++;
+            size = next;
+        } else {
+            for (; a < b; a += size) tui_series_take(s, k, a / size, &lo, &hi);
+        }
+    }
+    
+    if (min) *min = lo;
+    if (max) *max = hi;
+    return true;
+}
+
+#ifndef TUI_NO_WIDGETS
+/* Render the newest `window` points (0 = all) into a Braille canvas using
+ * min/max bucketing: one range query per pixel column */
+static void tui_chart_render(tui_canvas* canvas, const tui_series* s, int window,
+                             float y_min, float y_max, bool area) {
+    int n = s ? s->count : 0;
+    int first = (window > 0 && window < n) ? n - window : 0;
+    int count = n - first;
+    int width = canvas->width;
+    int height = canvas->height;
+    if (count <= 0 || width <= 0 || height <= 0) return;
+    
+    float lo = y_min;
+    float hi = y_max;
+    if (lo >= hi) tui_series_range(s, first, n, &lo, &hi);
+    if (hi - lo < 1e-12f) {
+        lo -= 1.0f;
+        hi += 1.0f;
+    }
+    float scale = (float)(height - 1) / (hi - lo);
+    
+    int prev_top = 0;
+    int prev_bottom = 0;
+    int columns = count < width ? count : width;
+    
+    for (int c = 0; c < columns; c++) {
+        int a = first + (int)((int64_t)c * count / columns);
+        int b = first + (int)((int64_t)(c + 1) * count / columns);
+        float mn, mx;
+        tui_series_range(s, a, b, &mn, &mx);
+        
+        int top = height - 1 - (int)((mx - lo) * scale + 0.5f);
+        int bottom = height - 1 - (int)((mn - lo) * scale + 0.5f);
+        if (top < 0) top = 0;
+        if (bottom > height - 1) bottom = height - 1;
+        if (top > bottom) top = bottom;
+        
+        /* Fewer points than pixels: spread them across the width */
+        int x = columns > 1 ? (int)((int64_t)c * (width - 1) / (columns - 1)) : 0;
+        int prev_x = columns > 1 ? (int)((int64_t)(c - 1) * (width - 1) / (columns - 1)) : 0;
+        
+        if (area) {
+            tui_canvas_line(canvas, x, top, x, height - 1);
+            if (c > 0 && x - prev_x > 1) {
+                for (int fx = prev_x + 1; fx < x; fx++) {
+                    int fy = prev_top + (top - prev_top) * (fx - prev_x) / (x - prev_x);
+                    tui_canvas_line(canvas, fx, fy, fx, height - 1);
+                }
+            }
+        } else {
+            tui_canvas_line(canvas, x, top, x, bottom);
+            /* Join disjoint neighbouring columns */
+            if (c > 0 && (top > prev_bottom || bottom < prev_top || x - prev_x > 1)) {
+                if (top > prev_bottom) {
+                    tui_canvas_line(canvas, prev_x, prev_bottom, x, top);
+                } else if (bottom < prev_top) {
+                    tui_canvas_line(canvas, prev_x, prev_top, x, bottom);
+                } else {
+                    tui_canvas_line(canvas, prev_x, prev_bottom, x, bottom);
+                }
+            }
+        }
+        prev_top = top;
+        prev_bottom = bottom;
+    }
+}
+#endif
+
 /* ============================================================================
  * Theme Definitions
  * ============================================================================ */
@@ -2567,6 +4518,7 @@ const tui_theme TUI_THEME_DEFAULT = {
     .border_style = TUI_BORDER_SINGLE
 };
 
+#ifndef TUI_NO_THEMES
 const tui_theme TUI_THEME_DARK = {
     .bg = TUI_RGB(20, 20, 25),
     .fg = TUI_RGB(200, 200, 200),
@@ -2646,10 +4598,57 @@ const tui_theme TUI_THEME_GREEN = {
     .info = TUI_RGB(100, 200, 180),
     .border_style = TUI_BORDER_BOLD
 };
+#endif
+
+/* Derive every token from the theme; the only per-theme color work */
+static void tui_theme_resolve(tui_context* ctx) {
+    const tui_theme* t = ctx->theme;
+    tui_style* k = ctx->tokens;
+    
+    k[TUI_TOKEN_TEXT] = tui_style_make(t->fg, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_DISABLED] = tui_style_make(t->fg_dim, t->bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_BUTTON] = tui_style_make(t->widget_fg, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_BUTTON_FOCUSED] = tui_style_make(t->focus_fg, t->focus_bg, TUI_STYLE_BOLD);
+    k[TUI_TOKEN_BUTTON_PRESSED] = tui_style_make(t->widget_bg, t->accent, TUI_STYLE_BOLD);
+    k[TUI_TOKEN_TOGGLE_FOCUSED] = tui_style_make(t->accent, t->bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_INPUT] = tui_style_make(t->widget_fg, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_INPUT_FOCUSED] = tui_style_make(t->focus_fg, t->focus_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_CURSOR] = tui_style_make(t->focus_bg, t->focus_fg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_SELECTION] = tui_style_make(t->select_fg, t->select_bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_LIST_CURRENT] = tui_style_make(t->widget_bg, t->accent, TUI_STYLE_NONE);
+    k[TUI_TOKEN_LIST_CURRENT_BLURRED] = tui_style_make(t->widget_fg, t->widget_border, TUI_STYLE_NONE);
+    k[TUI_TOKEN_TAB] = tui_style_make(t->fg_dim, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_TAB_ACTIVE] = tui_style_make(t->widget_bg, t->accent, TUI_STYLE_NONE);
+    k[TUI_TOKEN_TAB_ACTIVE_BLURRED] = tui_style_make(t->widget_fg, t->widget_border, TUI_STYLE_NONE);
+    k[TUI_TOKEN_SEPARATOR] = tui_style_make(t->widget_border, t->bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_DROPDOWN] = tui_style_make(t->widget_fg, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_DROPDOWN_FOCUSED] = tui_style_make(t->widget_bg, t->accent, TUI_STYLE_NONE);
+    k[TUI_TOKEN_MENU] = tui_style_make(t->widget_fg, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_MENU_SELECTED] = tui_style_make(t->select_fg, t->select_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_SPIN_BUTTON] = tui_style_make(t->fg_dim, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_SPIN_BUTTON_FOCUSED] = tui_style_make(t->focus_fg, t->widget_bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_TRACK] = tui_style_make(t->widget_border, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_FILL] = tui_style_make(t->success, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_THUMB] = tui_style_make(t->widget_fg, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_THUMB_FOCUSED] = tui_style_make(t->accent, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_DIVIDER] = tui_style_make(t->widget_border, t->bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_DIVIDER_ACTIVE] = tui_style_make(t->accent, t->bg, TUI_STYLE_NONE);
+    
+    k[TUI_TOKEN_GUTTER] = tui_style_make(t->fg_dim, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_GUTTER_EMPTY] = tui_style_make(t->widget_border, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_POPUP] = tui_style_make(t->widget_fg, t->widget_bg, TUI_STYLE_NONE);
+    k[TUI_TOKEN_POPUP_TITLE] = tui_style_make(t->accent, t->widget_bg, TUI_STYLE_BOLD);
+}
 
 void tui_set_theme(tui_context* ctx, const tui_theme* theme) {
     if (ctx) {
         ctx->theme = theme ? theme : &TUI_THEME_DEFAULT;
+        tui_theme_resolve(ctx);
     }
 }
 
@@ -2660,6 +4659,17 @@ const tui_theme* tui_get_theme(tui_context* ctx) {
     return &TUI_THEME_DEFAULT;
 }
 
+tui_style tui_theme_token(tui_context* ctx, tui_style_token token) {
+    if (!ctx || (unsigned)token >= TUI_TOKEN_COUNT) {
+        return tui_style_make(TUI_COLOR_DEFAULT, TUI_COLOR_DEFAULT, TUI_STYLE_NONE);
+    }
+    return ctx->tokens[token];
+}
+
+void tui_push_token(tui_context* ctx, tui_style_token token) {
+    tui_push_style(ctx, tui_theme_token(ctx, token));
+}
+
 /* ============================================================================
  * Animation Helpers
  * ============================================================================ */
@@ -2691,12 +4701,125 @@ float tui_ease_in_out(float t) {
     return 0.5f + t * (2.0f - 2.0f * t);
 }
 
-/* ============================================================================
- * Hierarchical Widget System - Implementation
- * ============================================================================ */
+/* Blend two packed colors by a/256, red and blue in one multiply */
+static inline uint32_t tui_blend_rgb(uint32_t c, uint32_t t, uint32_t a) {
+    uint32_t rb = ((c & 0xFF00FF) * (256 - a) + (t & 0xFF00FF) * a) >> 8;
+    uint32_t g = ((c & 0x00FF00) * (256 - a) + (t & 0x00FF00) * a) >> 8;
+    return (rb & 0xFF00FF) | (g & 0x00FF00);
+}
+
+static inline uint32_t tui_gray_rgb(uint32_t c) {
+    uint32_t l = (((c >> 16) & 0xFF) * 77 + ((c >> 8) & 0xFF) * 150 + (c & 0xFF) * 29) >> 8;
+    return l * 0x010101;
+}
+
+/* Default colors blend from the theme's colors (or white on black) */
+static inline uint32_t tui_resolve_default(uint32_t c, uint32_t fallback) {
+    uint32_t m = 0u - (c >> 31);
+    return (c & ~m) | (fallback & m);
+}
+
+#ifdef TUI_SIMD_SSE2
+/* One cell per vector: codepoint, fg, bg and underline_color are adjacent
+ * 32-bit fields, so a 16-byte load covers all three colors. Channels are
+ * widened to 16 bits and blended as c * (256 - a) + t * a >> 8, which is
+ * exactly what tui_blend_rgb computes. The codepoint lane, untouched
+ * channels and a default underline are put back from the loaded cell. */
+static void tui_transform_row_sse2(tui_cell* cell, int n, bool do_fg, bool do_bg, bool gray,
+                                   uint32_t def_fg, uint32_t def_bg, uint32_t target, uint32_t a) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i def = _mm_set_epi32(0, (int)def_bg, (int)def_fg, 0);
+    const __m128i act = _mm_set_epi32(do_fg ? -1 : 0, do_bg ? -1 : 0, do_fg ? -1 : 0, 0);
+    const __m128i ul_lane = _mm_set_epi32(-1, 0, 0, 0);
+    const __m128i inv_a = _mm_set1_epi16((short)(256 - a));
+    const __m128i va = _mm_set1_epi16((short)a);
+    const __m128i ta = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)target), zero), va);
+    const __m128i luma = _mm_set_epi16(0, 77, 150, 29, 0, 77, 150, 29);
+    
+    for (int i = 0; i < n; i++) {
+        __m128i x = _mm_loadu_si128((const __m128i*)&cell[i]);
+        __m128i d = _mm_srai_epi32(x, 31);  /* TUI_COLOR_DEFAULT lanes */
+        __m128i c = _mm_or_si128(_mm_andnot_si128(d, x), _mm_and_si128(d, def));
+        __m128i lo = _mm_unpacklo_epi8(c, zero);
+        __m128i hi = _mm_unpackhi_epi8(c, zero);
+        __m128i tl = ta;
+        __m128i th = ta;
+        if (gray) {
+            /* b*29 + g*150 and r*77 per color, summed, >> 8, spread to b, g, r */
+            __m128i ml = _mm_madd_epi16(lo, luma);
+            __m128i mh = _mm_madd_epi16(hi, luma);
+            ml = _mm_srli_epi32(_mm_add_epi32(ml, _mm_srli_epi64(ml, 32)), 8);
+            mh = _mm_srli_epi32(_mm_add_epi32(mh, _mm_srli_epi64(mh, 32)), 8);
+            ml = _mm_shufflehi_epi16(_mm_shufflelo_epi16(ml, _MM_SHUFFLE(1, 0, 0, 0)), _MM_SHUFFLE(1, 0, 0, 0));
+            mh = _mm_shufflehi_epi16(_mm_shufflelo_epi16(mh, _MM_SHUFFLE(1, 0, 0, 0)), _MM_SHUFFLE(1, 0, 0, 0));
+            tl = _mm_mullo_epi16(ml, va);
+            th = _mm_mullo_epi16(mh, va);
+        }
+        __m128i rl = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, inv_a), tl), 8);
+        __m128i rh = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, inv_a), th), 8);
+        __m128i r = _mm_packus_epi16(rl, rh);
+        __m128i keep = _mm_or_si128(_mm_andnot_si128(act, _mm_set1_epi32(-1)), _mm_and_si128(d, ul_lane));
+        r = _mm_or_si128(_mm_andnot_si128(keep, r), _mm_and_si128(keep, x));
+        _mm_storeu_si128((__m128i*)&cell[i], r);
+    }
+}
+#endif
 
-/* Create a new widget */
-tui_widget* tui_widget_create(tui_widget_type type) {
+void tui_region_transform(tui_context* ctx, int x, int y, int w, int h,
+                          tui_transform_op op, uint32_t target, float amount) {
+    if (!ctx || !ctx->in_frame || amount <= 0.0f) return;
+    
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > ctx->width ? ctx->width : x + w;
+    int y1 = y + h > ctx->height ? ctx->height : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+    
+    const tui_theme* theme = tui_get_theme(ctx);
+    uint32_t def_fg = theme->fg != TUI_COLOR_DEFAULT ? theme->fg : TUI_COLOR_WHITE;
+    uint32_t def_bg = theme->bg != TUI_COLOR_DEFAULT ? theme->bg : TUI_COLOR_BLACK;
+    uint32_t a = amount >= 1.0f ? 256 : (uint32_t)(amount * 256.0f);
+    bool do_fg = op != TUI_TRANSFORM_BG;
+    bool do_bg = op != TUI_TRANSFORM_FG;
+    bool gray = op == TUI_TRANSFORM_DESATURATE;
+    target &= 0xFFFFFF;
+    
+    for (int row = y0; row < y1; row++) {
+        tui_cell* cell = &ctx->back_buffer[row * TUI_MAX_WIDTH + x0];
+        int n = x1 - x0;
+#ifdef TUI_SIMD_SSE2
+        tui_transform_row_sse2(cell, n, do_fg, do_bg, gray, def_fg, def_bg, target, a);
+#else
+        if (do_fg) {
+            for (int i = 0; i < n; i++) {
+                uint32_t c = tui_resolve_default(cell[i].fg, def_fg);
+                cell[i].fg = tui_blend_rgb(c, gray ? tui_gray_rgb(c) : target, a);
+            }
+            for (int i = 0; i < n; i++) {
+                uint32_t c = cell[i].underline_color;
+                if (c != TUI_COLOR_DEFAULT) {
+                    cell[i].underline_color = tui_blend_rgb(c, gray ? tui_gray_rgb(c) : target, a);
+                }
+            }
+        }
+        if (do_bg) {
+            for (int i = 0; i < n; i++) {
+                uint32_t c = tui_resolve_default(cell[i].bg, def_bg);
+                cell[i].bg = tui_blend_rgb(c, gray ? tui_gray_rgb(c) : target, a);
+            }
+        }
+#endif
+    }
+}
+
+#ifndef TUI_NO_WIDGETS
+
+/* ============================================================================
+ * Hierarchical Widget System - Implementation
+ * ============================================================================ */
+
+/* Create a new widget */
+tui_widget* tui_widget_create(tui_widget_type type) {
     tui_widget* w = (tui_widget*)calloc(1, sizeof(tui_widget));
     if (!w) return NULL;
     
@@ -2706,7 +4829,9 @@ tui_widget* tui_widget_create(tui_widget_type type) {
     w->enabled = true;
     w->focusable = (type == TUI_WIDGET_BUTTON || 
                     type == TUI_WIDGET_TEXTBOX || 
+#ifndef TUI_NO_TEXTAREA
                     type == TUI_WIDGET_TEXTAREA ||
+#endif
                     type == TUI_WIDGET_CHECKBOX ||
                     type == TUI_WIDGET_RADIO ||
                     type == TUI_WIDGET_SLIDER ||
@@ -2717,21 +4842,60 @@ tui_widget* tui_widget_create(tui_widget_type type) {
     w->bg_color = TUI_COLOR_DEFAULT;
     w->fg_color = TUI_COLOR_DEFAULT;
     w->border_style = TUI_BORDER_NONE;
+    w->dirty = true;
     
     /* Type-specific initialization */
-    if (type == TUI_WIDGET_TEXTAREA) {
-        w->state.textarea.sel_start_row = -1;  /* No selection */
+    if (type == TUI_WIDGET_LIST) {
+        w->state.list.anchor = -1;
     } else if (type == TUI_WIDGET_SPLITTER) {
         w->state.splitter.ratio = 0.5f;
         w->state.splitter.min_size = 3;
+    } else if (type == TUI_WIDGET_SPARKLINE || type == TUI_WIDGET_BARS) {
+        w->state.sparkline.bar_width = 1;
+        w->state.sparkline.gap = (type == TUI_WIDGET_BARS) ? 1 : 0;
+#ifndef TUI_NO_TEXTAREA
+    } else if (type == TUI_WIDGET_TEXTAREA) {
+        w->state.textarea.sel_start_row = -1;  /* No selection */
+#endif
     }
     
     return w;
 }
 
+#ifndef TUI_NO_TEXTAREA
+static void tui_undo_log_free(tui_undo_log* log);
+static void tui_highlight_cache_free(tui_highlight_cache* hl);
+static void tui_wrap_index_free(tui_wrap_index* wrap);
+static void tui_line_cache_free(tui_line_cache* lc);
+#endif
+static void tui_sample_ring_free(tui_sample_ring* ring);
+static void tui_image_cache_free(tui_image_cache* ic);
+static void tui_step_state_free(tui_step_state* st);
+
 /* Destroy a widget (not recursive) */
 void tui_widget_destroy(tui_widget* widget) {
     if (widget) {
+        if (widget->overlay_wm) tui_wm_close_overlay(widget->overlay_wm, widget);
+        tui_widget_unbind(widget);
+        tui_step_state_free(widget->step);
+        if (widget->type == TUI_WIDGET_CHART) {
+            tui_canvas_destroy(widget->state.chart.canvas);
+        } else if (widget->type == TUI_WIDGET_SPARKLINE || widget->type == TUI_WIDGET_BARS) {
+            tui_sample_ring_free(widget->state.sparkline.ring);
+        } else if (widget->type == TUI_WIDGET_HEATMAP) {
+            free(widget->state.heatmap.lut);
+        } else if (widget->type == TUI_WIDGET_IMAGE) {
+            tui_image_cache_free(widget->state.image.cache);
+        } else if (widget->type == TUI_WIDGET_SCROLLVIEW) {
+            free(widget->state.scrollview.cache);
+#ifndef TUI_NO_TEXTAREA
+        } else if (widget->type == TUI_WIDGET_TEXTAREA) {
+            tui_undo_log_free(widget->state.textarea.undo);
+            tui_highlight_cache_free(widget->state.textarea.highlight);
+            tui_wrap_index_free(widget->state.textarea.wrap);
+            tui_line_cache_free(widget->state.textarea.line_info);
+#endif
+        }
         free(widget);
     }
 }
@@ -2759,6 +4923,7 @@ void tui_widget_add_child(tui_widget* parent, tui_widget* child) {
     
     parent->children[parent->child_count++] = child;
     child->parent = parent;
+    tui_widget_invalidate(parent);
 }
 
 /* Remove a child widget */
@@ -2773,6 +4938,7 @@ void tui_widget_remove_child(tui_widget* parent, tui_widget* child) {
             }
             parent->child_count--;
             child->parent = NULL;
+            tui_widget_invalidate(parent);
             return;
         }
     }
@@ -2824,6 +4990,10 @@ void tui_widget_get_absolute_bounds(tui_widget* w, int* x, int* y, int* width, i
     while (p) {
         abs_x += p->x;
         abs_y += p->y;
+        if (p->type == TUI_WIDGET_SCROLLVIEW) {
+            abs_x -= p->state.scrollview.scroll_x;
+            abs_y -= p->state.scrollview.scroll_y;
+        }
         p = p->parent;
     }
     
@@ -2907,7 +5077,9 @@ void tui_wm_init(tui_widget_manager* wm) {
 
 /* Set root widget */
 void tui_wm_set_root(tui_widget_manager* wm, tui_widget* root) {
-    if (wm) wm->root = root;
+    if (!wm) return;
+    wm->root = root;
+    wm->drawn = false;
 }
 
 /* Call handlers for a widget during a phase */
@@ -2958,11 +5130,128 @@ static tui_widget* tui_widget_hit_test_recursive(tui_widget* w, int x, int y) {
     return w;
 }
 
+/* An overlay owner a pushed modal covers */
+static bool tui_wm_behind_modal(tui_widget_manager* wm, tui_widget* owner) {
+    if (wm->focus_stack_top <= 0) return false;
+    tui_widget* modal = wm->focus_stack[wm->focus_stack_top - 1];
+    for (tui_widget* p = owner; p; p = p->parent) {
+        if (p == modal) return false;
+    }
+    return true;
+}
+
 tui_widget* tui_wm_hit_test(tui_widget_manager* wm, int x, int y) {
-    if (!wm || !wm->root) return NULL;
+    if (!wm) return NULL;
+    
+    /* Overlays first, top-most first */
+    for (int i = wm->overlay_count - 1; i >= 0; i--) {
+        tui_overlay* ov = &wm->overlays[i];
+        if (tui_wm_behind_modal(wm, ov->owner)) continue;
+        if (x >= ov->x && x < ov->x + ov->width && y >= ov->y && y < ov->y + ov->height) {
+            return ov->owner;
+        }
+    }
+    
+    if (!wm->root) return NULL;
     return tui_widget_hit_test_recursive(wm->root, x, y);
 }
 
+/* ============================================================================
+ * Overlay Layer
+ * ============================================================================ */
+
+static void tui_wm_add_damage(tui_widget_manager* wm, int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0) return;
+    if (wm->damage_w <= 0 || wm->damage_h <= 0) {
+        wm->damage_x = x;
+        wm->damage_y = y;
+        wm->damage_w = w;
+        wm->damage_h = h;
+        return;
+    }
+    int x0 = x < wm->damage_x ? x : wm->damage_x;
+    int y0 = y < wm->damage_y ? y : wm->damage_y;
+    int x1 = x + w > wm->damage_x + wm->damage_w ? x + w : wm->damage_x + wm->damage_w;
+    int y1 = y + h > wm->damage_y + wm->damage_h ? y + h : wm->damage_y + wm->damage_h;
+    wm->damage_x = x0;
+    wm->damage_y = y0;
+    wm->damage_w = x1 - x0;
+    wm->damage_h = y1 - y0;
+}
+
+static int tui_wm_find_overlay(tui_widget_manager* wm, tui_widget* owner) {
+    for (int i = 0; i < wm->overlay_count; i++) {
+        if (wm->overlays[i].owner == owner) return i;
+    }
+    return -1;
+}
+
+static void tui_wm_remove_overlay(tui_widget_manager* wm, int i) {
+    tui_overlay* ov = &wm->overlays[i];
+    if (ov->owner->overlay_wm == wm) ov->owner->overlay_wm = NULL;
+    tui_wm_add_damage(wm, ov->x, ov->y, ov->width, ov->height);
+    memmove(&wm->overlays[i], &wm->overlays[i + 1],
+            (size_t)(wm->overlay_count - i - 1) * sizeof(tui_overlay));
+    wm->overlay_count--;
+}
+
+bool tui_wm_open_overlay(tui_widget_manager* wm, tui_widget* owner, int x, int y,
+                         int width, int height, int z, tui_widget_draw_fn draw_fn) {
+    if (!wm || !owner || width <= 0 || height <= 0) return false;
+    if (tui_wm_behind_modal(wm, owner)) {
+        tui_wm_close_overlay(wm, owner);
+        return false;
+    }
+    
+    int i = tui_wm_find_overlay(wm, owner);
+    if (i >= 0) {
+        tui_overlay* ov = &wm->overlays[i];
+        ov->seen = true;
+        ov->draw_fn = draw_fn;
+        if (ov->x == x && ov->y == y && ov->width == width && ov->height == height && ov->z == z) {
+            return true;
+        }
+        tui_wm_remove_overlay(wm, i);
+    }
+    if (wm->overlay_count >= TUI_MAX_OVERLAYS) return false;
+    
+    /* Insert after overlays of equal or lower z */
+    int pos = wm->overlay_count;
+    while (pos > 0 && wm->overlays[pos - 1].z > z) pos--;
+    memmove(&wm->overlays[pos + 1], &wm->overlays[pos],
+            (size_t)(wm->overlay_count - pos) * sizeof(tui_overlay));
+    wm->overlay_count++;
+    
+    tui_overlay* ov = &wm->overlays[pos];
+    ov->owner = owner;
+    owner->overlay_wm = wm;
+    ov->x = x;
+    ov->y = y;
+    ov->width = width;
+    ov->height = height;
+    ov->z = z;
+    ov->draw_fn = draw_fn;
+    ov->seen = true;
+    tui_wm_add_damage(wm, x, y, width, height);
+    return true;
+}
+
+void tui_wm_close_overlay(tui_widget_manager* wm, tui_widget* owner) {
+    if (!wm) return;
+    int i = tui_wm_find_overlay(wm, owner);
+    if (i >= 0) tui_wm_remove_overlay(wm, i);
+}
+
+bool tui_wm_take_damage(tui_widget_manager* wm, int* x, int* y, int* width, int* height) {
+    if (!wm || wm->damage_w <= 0 || wm->damage_h <= 0) return false;
+    if (x) *x = wm->damage_x;
+    if (y) *y = wm->damage_y;
+    if (width) *width = wm->damage_w;
+    if (height) *height = wm->damage_h;
+    wm->damage_w = wm->damage_h = 0;
+    return true;
+}
+
 /* Find next focusable widget */
 static tui_widget* tui_widget_find_next_focusable(tui_widget* root, tui_widget* current, bool forward) {
     if (!root) return NULL;
@@ -3023,18 +5312,23 @@ static tui_widget* tui_widget_find_next_focusable(tui_widget* root, tui_widget*
 }
 
 /* Focus a widget */
+static void tui_scrollview_reveal(tui_widget* w);
+
 void tui_wm_focus(tui_widget_manager* wm, tui_widget* widget) {
     if (!wm) return;
     
     /* Unfocus current */
     if (wm->focus) {
         wm->focus->focused = false;
+        tui_widget_invalidate(wm->focus);
     }
     
     /* Focus new */
     wm->focus = widget;
     if (widget) {
         widget->focused = true;
+        tui_scrollview_reveal(widget);
+        tui_widget_invalidate(widget);
     }
 }
 
@@ -3155,138 +5449,1489 @@ static bool tui_wm_check_hotkeys(tui_widget_manager* wm, tui_widget_event* event
 }
 
 /* ============================================================================
- * Default Widget Input Handling
+ * Sample Rings (sparkline / bars)
  * ============================================================================ */
 
-/* Handle textbox input */
-static bool tui_widget_handle_textbox_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e || e->base.type != TUI_EVENT_KEY) return false;
-    if (!w->state.textbox.buffer) return false;
+/* Fixed-capacity ring of samples. Running min and max come from monotonic
+ * deques of sample sequence numbers, so eviction never forces a rescan, and
+ * a binary search in them gives the extremes of just the samples on screen.
+ * Bar heights are cached per sample and only computed for new samples, or
+ * for the shown ones when the scale or height changed since the last draw. */
+struct tui_sample_ring {
+    float* values;
+    uint16_t* levels;       /* Bar height in eighths of a cell */
+    int64_t* min_q;         /* Sequence numbers with increasing values */
+    int64_t* max_q;         /* Sequence numbers with decreasing values */
+    int min_head, min_len;
+    int max_head, max_len;
+    int capacity;
+    int count;
+    int64_t pushed;         /* Sequence number of the next sample */
+    int64_t level_from;     /* Samples in [level_from, leveled) have valid levels */
+    int64_t leveled;
+    float level_lo;         /* Scale the levels were computed for */
+    float level_hi;
+    int level_max;
+};
+
+static void tui_sample_ring_free(tui_sample_ring* ring) {
+    if (!ring) return;
+    free(ring->values);
+    free(ring->levels);
+    free(ring->min_q);
+    free(ring->max_q);
+    free(ring);
+}
+
+static float tui_sample_ring_value(const tui_sample_ring* ring, int64_t seq) {
+    return ring->values[seq % ring->capacity];
+}
+
+bool tui_sparkline_set_capacity(tui_widget* w, int capacity) {
+    if (!w || (w->type != TUI_WIDGET_SPARKLINE && w->type != TUI_WIDGET_BARS) || capacity <= 0) return false;
     
-    char* buf = w->state.textbox.buffer;
-    int cap = w->state.textbox.capacity;
-    int* len = &w->state.textbox.length;
-    int* cursor = &w->state.textbox.cursor;
+    tui_sample_ring* ring = (tui_sample_ring*)calloc(1, sizeof(tui_sample_ring));
+    if (!ring) return false;
+    ring->values = (float*)malloc((size_t)capacity * sizeof(float));
+    ring->levels = (uint16_t*)malloc((size_t)capacity * sizeof(uint16_t));
+    ring->min_q = (int64_t*)malloc((size_t)capacity * sizeof(int64_t));
+    ring->max_q = (int64_t*)malloc((size_t)capacity * sizeof(int64_t));
+    if (!ring->values || !ring->levels || !ring->min_q || !ring->max_q) {
+        tui_sample_ring_free(ring);
+        return false;
+    }
+    ring->capacity = capacity;
+    ring->level_max = -1;
     
-    tui_key key = e->base.key;
-    uint32_t ch = e->base.ch;
+    tui_sample_ring_free(w->state.sparkline.ring);
+    w->state.sparkline.ring = ring;
+    return true;
+}
+
+void tui_sparkline_clear(tui_widget* w) {
+    if (!w || (w->type != TUI_WIDGET_SPARKLINE && w->type != TUI_WIDGET_BARS)) return;
+    tui_sample_ring* ring = w->state.sparkline.ring;
+    if (!ring) return;
+    ring->count = 0;
+    ring->min_len = ring->max_len = 0;
+    ring->level_from = ring->leveled = ring->pushed;
+}
+
+void tui_sparkline_push(tui_widget* w, float value) {
+    if (!w || (w->type != TUI_WIDGET_SPARKLINE && w->type != TUI_WIDGET_BARS)) return;
+    tui_sample_ring* ring = w->state.sparkline.ring;
+    if (!ring) return;
+    int cap = ring->capacity;
+    int64_t seq = ring->pushed;
     
-    switch (key) {
-        case TUI_KEY_LEFT:
-            if (*cursor > 0) (*cursor)--;
-            return true;
-            
-        case TUI_KEY_RIGHT:
-            if (*cursor < *len) (*cursor)++;
-            return true;
-            
-        case TUI_KEY_HOME:
-            *cursor = 0;
-            return true;
-            
-        case TUI_KEY_END:
-            *cursor = *len;
-            return true;
-            
-        case TUI_KEY_BACKSPACE:
-            if (*cursor > 0) {
-                memmove(buf + *cursor - 1, buf + *cursor, (size_t)(*len - *cursor + 1));
-                (*cursor)--;
-                (*len)--;
-            }
-            return true;
-            
-        case TUI_KEY_DELETE:
-            if (*cursor < *len) {
-                memmove(buf + *cursor, buf + *cursor + 1, (size_t)(*len - *cursor));
-                (*len)--;
+    /* The oldest sample falls out of the window */
+    if (ring->count == cap) {
+        int64_t evicted = seq - cap;
+        if (ring->min_len > 0 && ring->min_q[ring->min_head] == evicted) {
+            ring->min_head = (ring->min_head + 1) % cap;
+            ring->min_len--;
+        }
+        if (ring->max_len > 0 && ring->max_q[ring->max_head] == evicted) {
+            ring->max_head = (ring->max_head + 1) % cap;
+            ring->max_len--;
+        }
+    } else {
+        ring->count++;
+    }
+    ring->values[seq % cap] = value;
+    
+    /* Drop samples that can no longer be the min / max */
+    while (ring->min_len > 0 &&
+           tui_sample_ring_value(ring, ring->min_q[(ring->min_head + ring->min_len - 1) % cap]) >= value) {
+        ring->min_len--;
+    }
+    ring->min_q[(ring->min_head + ring->min_len++) % cap] = seq;
+    while (ring->max_len > 0 &&
+           tui_sample_ring_value(ring, ring->max_q[(ring->max_head + ring->max_len - 1) % cap]) <= value) {
+        ring->max_len--;
+    }
+    ring->max_q[(ring->max_head + ring->max_len++) % cap] = seq;
+    
+    ring->pushed++;
+}
+
+/* Extreme of the samples from seq on: the first deque entry at or after it */
+static float tui_sample_ring_extreme(const tui_sample_ring* ring, const int64_t* q, int head, int len,
+                                     int64_t seq) {
+    int lo = 0, hi = len - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (q[(head + mid) % ring->capacity] < seq) lo = mid + 1;
+        else hi = mid;
+    }
+    return tui_sample_ring_value(ring, q[(head + lo) % ring->capacity]);
+}
+
+/* Draw the newest samples right-aligned, one bar per sample */
+static void tui_sparkline_draw(tui_widget* w, tui_context* ctx, int x, int y, int width, int height) {
+    tui_sample_ring* ring = w->state.sparkline.ring;
+    if (!ring || ring->count == 0 || width <= 0 || height <= 0) return;
+    
+    bool bars = w->type == TUI_WIDGET_BARS;
+    int bar_width = w->state.sparkline.bar_width > 0 ? w->state.sparkline.bar_width : 1;
+    int gap = w->state.sparkline.gap > 0 ? w->state.sparkline.gap : 0;
+    int stride = bar_width + gap;
+    int shown = (width + gap) / stride;
+    if (shown > ring->count) shown = ring->count;
+    if (shown <= 0) return;
+    int64_t first = ring->pushed - shown;
+    
+    /* Scale: fixed, or the min/max of the shown samples (bars always include zero) */
+    float lo = w->state.sparkline.y_min;
+    float hi = w->state.sparkline.y_max;
+    if (lo >= hi) {
+        lo = tui_sample_ring_extreme(ring, ring->min_q, ring->min_head, ring->min_len, first);
+        hi = tui_sample_ring_extreme(ring, ring->max_q, ring->max_head, ring->max_len, first);
+        if (bars && lo > 0.0f) lo = 0.0f;
+        if (bars && hi < 0.0f) hi = 0.0f;
+    }
+    
+    /* Sparklines keep the lowest sample visible as a one-eighth bar */
+    int base = bars ? 0 : 1;
+    int level_max = height * 8;
+    if (lo != ring->level_lo || hi != ring->level_hi || level_max != ring->level_max ||
+        ring->leveled < first) {
+        ring->level_lo = lo;
+        ring->level_hi = hi;
+        ring->level_max = level_max;
+        ring->level_from = ring->leveled = first;
+    }
+    
+    /* Level the shown samples not yet leveled: new ones, or older ones a
+     * wider view brought in */
+    float scale = hi > lo ? (float)(level_max - base) / (hi - lo) : 0.0f;
+    for (int64_t seq = first; seq < ring->pushed; seq++) {
+        if (seq >= ring->level_from && seq < ring->leveled) {
+            seq = ring->leveled - 1;
+            continue;
+        }
+        float v = tui_sample_ring_value(ring, seq);
+        int level = base + (int)((v - lo) * scale + 0.5f);
+        if (level < base) level = base;
+        if (level > level_max) level = level_max;
+        ring->levels[seq % ring->capacity] = (uint16_t)level;
+    }
+    if (first < ring->level_from) ring->level_from = first;
+    ring->leveled = ring->pushed;
+    
+    /* Bars grow from zero (snapped to a cell edge); below it they hang down,
+     * drawn as reversed lower blocks */
+    int zero = 0;
+    if (bars && lo < 0.0f) {
+        zero = ((int)((0.0f - lo) * scale + 0.5f) + 4) / 8 * 8;
+    }
+    int right = x + width;
+    
+    for (int i = 0; i < shown; i++) {
+        int64_t seq = ring->pushed - 1 - i;
+        int level = ring->levels[seq % ring->capacity];
+        int bx = right - bar_width - i * stride;
+        
+        for (int row = 0; row < height; row++) {
+            int bottom = row * 8;
+            uint32_t ch = ' ';
+            bool hang = false;
+            if (level >= zero) {
+                int fill = bottom >= zero ? level - bottom : 0;
+                ch = fill >= 8 ? 0x2588 : (fill > 0 ? 0x2580 + (uint32_t)fill : ' ');
+            } else if (bottom < zero) {
+                int gap8 = level - bottom;  /* Empty eighths at the bottom of the cell */
+                if (gap8 <= 0) {
+                    ch = 0x2588;
+                } else if (gap8 < 8) {
+                    ch = 0x2580 + (uint32_t)gap8;
+                    hang = true;
+                }
             }
-            return true;
-            
-        case TUI_KEY_CHAR:
-            if (ch >= 32 && ch < 127 && *len < cap - 1) {
-                memmove(buf + *cursor + 1, buf + *cursor, (size_t)(*len - *cursor + 1));
-                buf[*cursor] = (char)ch;
-                (*cursor)++;
-                (*len)++;
+            if (hang) {
+                tui_style style = tui_get_current_style(ctx);
+                style.attrs ^= TUI_STYLE_REVERSE;
+                tui_push_style(ctx, style);
             }
-            return true;
-            
-        case TUI_KEY_SPACE:
-            /* Space character for text input */
-            if (*len < cap - 1) {
-                memmove(buf + *cursor + 1, buf + *cursor, (size_t)(*len - *cursor + 1));
-                buf[*cursor] = ' ';
-                (*cursor)++;
-                (*len)++;
+            for (int c = 0; c < bar_width; c++) {
+                if (bx + c >= x) tui_set_cell(ctx, bx + c, y + height - 1 - row, ch);
             }
-            return true;
-            
-        default:
-            break;
+            if (hang) tui_pop_style(ctx);
+        }
     }
-    return false;
 }
 
-/* Handle checkbox input */
-static bool tui_widget_handle_checkbox_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+/* ============================================================================
+ * Heatmap
+ * ============================================================================ */
+
+static const uint32_t tui_heatmap_default_ramp[] = {
+    TUI_RGB(0, 0, 64), TUI_RGB(0, 96, 192), TUI_RGB(0, 192, 128),
+    TUI_RGB(240, 220, 0), TUI_RGB(220, 0, 0)
+};
+
+void tui_heatmap_set_ramp(tui_widget* w, const uint32_t* colors, int count) {
+    if (!w || w->type != TUI_WIDGET_HEATMAP) return;
+    if (!colors || count < 1) {
+        colors = tui_heatmap_default_ramp;
+        count = (int)(sizeof(tui_heatmap_default_ramp) / sizeof(tui_heatmap_default_ramp[0]));
+    }
     
-    bool toggle = false;
-    if (e->base.type == TUI_EVENT_KEY) {
-        if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
-            toggle = true;
+    uint32_t* lut = w->state.heatmap.lut;
+    if (!lut) {
+        lut = (uint32_t*)malloc(TUI_HEATMAP_LUT_SIZE * sizeof(uint32_t));
+        if (!lut) return;
+        w->state.heatmap.lut = lut;
+    }
+    
+    /* Sample the piecewise-linear ramp once; drawing is then a table lookup */
+    for (int i = 0; i < TUI_HEATMAP_LUT_SIZE; i++) {
+        float pos = (float)i / (float)(TUI_HEATMAP_LUT_SIZE - 1) * (float)(count - 1);
+        int stop = (int)pos;
+        if (stop >= count - 1) {
+            lut[i] = colors[count - 1];
+        } else {
+            lut[i] = tui_lerp_color(colors[stop], colors[stop + 1], pos - (float)stop);
         }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            toggle = true;
+    }
+}
+
+/* One value to a LUT index, branch-free; NaN maps to 0 */
+static inline uint8_t tui_heatmap_index(float v, float lo, float scale) {
+    float t = (v - lo) * scale;
+    t = t > 0.0f ? t : 0.0f;
+    t = t < (float)(TUI_HEATMAP_LUT_SIZE - 1) ? t : (float)(TUI_HEATMAP_LUT_SIZE - 1);
+    return (uint8_t)(int32_t)t;
+}
+
+/* Values to LUT indices. Whole blocks go through local arrays with a fixed
+ * trip count, which GCC vectorizes even at -O2 (no alias checks or epilogue
+ * needed); the tail is done one value at a time. */
+static void tui_heatmap_quantize(const float* in, uint8_t* out, int n, float lo, float scale) {
+    int i = 0;
+    for (; i + TUI_HEATMAP_BLOCK <= n; i += TUI_HEATMAP_BLOCK) {
+        float block[TUI_HEATMAP_BLOCK];
+        uint8_t idx[TUI_HEATMAP_BLOCK];
+        memcpy(block, in + i, sizeof(block));
+        for (int j = 0; j < TUI_HEATMAP_BLOCK; j++) idx[j] = tui_heatmap_index(block[j], lo, scale);
+        memcpy(out + i, idx, sizeof(idx));
+    }
+    for (; i < n; i++) out[i] = tui_heatmap_index(in[i], lo, scale);
+}
+
+/* Stretch the matrix over the widget (nearest neighbour) and write colors
+ * straight into the back buffer, one row of cells at a time */
+static void tui_heatmap_draw(tui_widget* w, tui_context* ctx, int x, int y, int width, int height) {
+    const float* values = w->state.heatmap.values;
+    int cols = w->state.heatmap.cols;
+    int rows = w->state.heatmap.rows;
+    bool half = w->state.heatmap.half_block;
+    if (!values || cols <= 0 || rows <= 0) return;
+    if (!w->state.heatmap.lut) tui_heatmap_set_ramp(w, NULL, 0);
+    const uint32_t* lut = w->state.heatmap.lut;
+    if (!lut) return;
+    
+    /* Clip */
+    int x0 = x < ctx->clip_x0 ? ctx->clip_x0 : x;
+    int x1 = x + width < ctx->clip_x1 ? x + width : ctx->clip_x1;
+    int y0 = y < ctx->clip_y0 ? ctx->clip_y0 : y;
+    int y1 = y + height < ctx->clip_y1 ? y + height : ctx->clip_y1;
+    if (x0 >= x1 || y0 >= y1) return;
+    int n = x1 - x0;
+    
+    float lo = w->state.heatmap.v_min;
+    float hi = w->state.heatmap.v_max;
+    float scale = hi > lo ? (float)(TUI_HEATMAP_LUT_SIZE - 1) / (hi - lo) : 0.0f;
+    int pixel_rows = half ? height * 2 : height;
+    
+    int src_col[TUI_MAX_WIDTH];
+    for (int i = 0; i < n; i++) {
+        src_col[i] = (int)((int64_t)(x0 - x + i) * cols / width);
+    }
+    
+    float row_values[TUI_MAX_WIDTH];
+    uint8_t top[TUI_MAX_WIDTH];
+    uint8_t bottom[TUI_MAX_WIDTH];
+    
+    tui_cell cell;
+    memset(&cell, 0, sizeof(cell));
+    cell.codepoint = half ? 0x2580 : ' ';  /* ▀: fg is the upper pixel */
+    cell.underline_color = TUI_COLOR_DEFAULT;
+    cell.style = TUI_STYLE_NONE;
+    
+    for (int sy = y0; sy < y1; sy++) {
+        int py = (sy - y) * (half ? 2 : 1);
+        const float* src = values + (size_t)((int64_t)py * rows / pixel_rows) * (size_t)cols;
+        for (int i = 0; i < n; i++) row_values[i] = src[src_col[i]];
+        tui_heatmap_quantize(row_values, top, n, lo, scale);
+        
+        if (half) {
+            src = values + (size_t)((int64_t)(py + 1) * rows / pixel_rows) * (size_t)cols;
+            for (int i = 0; i < n; i++) row_values[i] = src[src_col[i]];
+            tui_heatmap_quantize(row_values, bottom, n, lo, scale);
+        }
+        
+        tui_cell* dst = &ctx->back_buffer[sy * TUI_MAX_WIDTH + x0];
+        for (int i = 0; i < n; i++) {
+            cell.fg = lut[top[i]];
+            cell.bg = half ? lut[bottom[i]] : cell.fg;
+            dst[i] = cell;
         }
     }
+}
+
+/* ============================================================================
+ * Image
+ * ============================================================================ */
+
+/* Source pixels are area-averaged into a target grid of one pixel per cell
+ * column and two per cell row, then encoded as upper-half blocks. The last
+ * target grid is kept, so after tui_image_invalidate() only cells whose two
+ * pixels changed are re-encoded (all of them for Floyd-Steinberg, whose error
+ * diffusion crosses cells). Without an invalidate the cached cells are
+ * simply blitted. */
+struct tui_image_cache {
+    const uint8_t* source;  /* Layout the cache was built for */
+    int src_width;
+    int src_height;
+    int stride;
+    int width;              /* Target grid in pixels */
+    int height;
+    int off_x;              /* Cell offset that centers the image */
+    int off_y;
+    int dither;
+    bool stale;             /* Source pixels changed */
+    bool primed;            /* pixels/cells hold a previous frame */
+    int* col_range;         /* Source columns [start, end) per target column */
+    uint32_t* sums;         /* Per-column channel sums for one target row */
+    uint8_t* pixels;        /* Target grid (RGB) */
+    uint8_t* prev;          /* Previous target grid */
+    uint8_t* quant;         /* Dithered grid (Floyd-Steinberg) */
+    int* errors;            /* Error rows (Floyd-Steinberg) */
+    uint8_t* changed;       /* Cells to re-encode */
+    tui_cell* cells;
+};
+
+/* xterm 6x6x6 cube levels */
+static const uint8_t tui_cube_levels[6] = {0, 95, 135, 175, 215, 255};
+
+static const int8_t tui_bayer4[4][4] = {
+    {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}
+};
+
+static int tui_cube_index(int c) {
+    if (c < 48) return 0;
+    if (c < 115) return 1;
+    int idx = (c - 35) / 40;
+    return idx > 5 ? 5 : idx;
+}
+
+static void tui_image_cache_free(tui_image_cache* ic) {
+    if (!ic) return;
+    free(ic->col_range);
+    free(ic->sums);
+    free(ic->pixels);
+    free(ic->prev);
+    free(ic->quant);
+    free(ic->errors);
+    free(ic->changed);
+    free(ic->cells);
+    free(ic);
+}
+
+void tui_image_invalidate(tui_widget* w) {
+    if (w && w->type == TUI_WIDGET_IMAGE && w->state.image.cache) {
+        w->state.image.cache->stale = true;
+    }
+}
+
+/* (Re)allocate the scratch buffers for a tw x th target grid */
+static bool tui_image_layout(tui_image_cache* ic, int tw, int th) {
+    size_t px = (size_t)tw * (size_t)th * 3;
+    size_t cells = (size_t)tw * (size_t)((th + 1) / 2);
+    
+    free(ic->col_range);
+    free(ic->sums);
+    free(ic->pixels);
+    free(ic->prev);
+    free(ic->quant);
+    free(ic->errors);
+    free(ic->changed);
+    free(ic->cells);
+    ic->col_range = (int*)malloc((size_t)tw * 2 * sizeof(int));
+    ic->sums = (uint32_t*)malloc((size_t)tw * 3 * sizeof(uint32_t));
+    ic->pixels = (uint8_t*)calloc(px, 1);  /* Defined before the first diff */
+    ic->prev = (uint8_t*)calloc(px, 1);
+    ic->quant = (uint8_t*)malloc(px);
+    ic->errors = (int*)malloc((size_t)(tw + 2) * 3 * 2 * sizeof(int));
+    ic->changed = (uint8_t*)malloc(cells);
+    ic->cells = (tui_cell*)malloc(cells * sizeof(tui_cell));
+    ic->width = tw;
+    ic->height = th;
+    ic->primed = false;
+    ic->stale = true;  /* New grid: rescale even if the source is unchanged */
+    
+    if (!ic->col_range || !ic->sums || !ic->pixels || !ic->prev || !ic->quant ||
+        !ic->errors || !ic->changed || !ic->cells) {
+        ic->width = ic->height = 0;
+        return false;
+    }
+    return true;
+}
+
+/* Box-filter the source into the target grid (upscaling repeats pixels) */
+static void tui_image_scale(tui_image_cache* ic, const uint8_t* src, int iw, int ih, int stride) {
+    int tw = ic->width;
+    int th = ic->height;
+    int* range = ic->col_range;
     
-    if (toggle) {
-        w->state.checkbox.checked = !w->state.checkbox.checked;
-        return true;
+    for (int tx = 0; tx < tw; tx++) {
+        int x0 = (int)((int64_t)tx * iw / tw);
+        int x1 = (int)((int64_t)(tx + 1) * iw / tw);
+        range[2 * tx] = x0;
+        range[2 * tx + 1] = x1 > x0 ? x1 : x0 + 1;
+    }
+    
+    for (int ty = 0; ty < th; ty++) {
+        int y0 = (int)((int64_t)ty * ih / th);
+        int y1 = (int)((int64_t)(ty + 1) * ih / th);
+        if (y1 <= y0) y1 = y0 + 1;
+        
+        uint32_t* sums = ic->sums;
+        memset(sums, 0, (size_t)tw * 3 * sizeof(uint32_t));
+        for (int sy = y0; sy < y1; sy++) {
+            const uint8_t* row = src + (size_t)sy * (size_t)stride;
+            for (int tx = 0; tx < tw; tx++) {
+                uint32_t r = 0, g = 0, b = 0;
+                for (int sx = range[2 * tx]; sx < range[2 * tx + 1]; sx++) {
+                    r += row[3 * sx];
+                    g += row[3 * sx + 1];
+                    b += row[3 * sx + 2];
+                }
+                sums[3 * tx] += r;
+                sums[3 * tx + 1] += g;
+                sums[3 * tx + 2] += b;
+            }
+        }
+        
+        uint8_t* out = ic->pixels + (size_t)ty * (size_t)tw * 3;
+        for (int tx = 0; tx < tw; tx++) {
+            uint32_t area = (uint32_t)((y1 - y0) * (range[2 * tx + 1] - range[2 * tx]));
+            out[3 * tx] = (uint8_t)((sums[3 * tx] + area / 2) / area);
+            out[3 * tx + 1] = (uint8_t)((sums[3 * tx + 1] + area / 2) / area);
+            out[3 * tx + 2] = (uint8_t)((sums[3 * tx + 2] + area / 2) / area);
+        }
     }
-    return false;
 }
 
-/* Handle radio button input */
-static bool tui_widget_handle_radio_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e || !w->state.radio.group_value) return false;
+/* Floyd-Steinberg onto the color cube, whole grid */
+static void tui_image_diffuse(tui_image_cache* ic) {
+    int tw = ic->width;
+    int* cur = ic->errors;
+    int* next = ic->errors + (tw + 2) * 3;
+    memset(cur, 0, (size_t)(tw + 2) * 3 * sizeof(int));
     
-    bool select = false;
-    if (e->base.type == TUI_EVENT_KEY) {
-        if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
-            select = true;
+    for (int ty = 0; ty < ic->height; ty++) {
+        memset(next, 0, (size_t)(tw + 2) * 3 * sizeof(int));
+        const uint8_t* in = ic->pixels + (size_t)ty * (size_t)tw * 3;
+        uint8_t* out = ic->quant + (size_t)ty * (size_t)tw * 3;
+        
+        for (int tx = 0; tx < tw; tx++) {
+            for (int ch = 0; ch < 3; ch++) {
+                int e = 3 * (tx + 1) + ch;      /* Error rows have a pad column each side */
+                int want = in[3 * tx + ch] + cur[e] / 16;
+                if (want < 0) want = 0;
+                if (want > 255) want = 255;
+                int got = tui_cube_levels[tui_cube_index(want)];
+                int err = want - got;
+                out[3 * tx + ch] = (uint8_t)got;
+                cur[e + 3] += err * 7;
+                next[e - 3] += err * 3;
+                next[e] += err * 5;
+                next[e + 3] += err;
+            }
         }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            select = true;
+        int* tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+}
+
+/* Final color of target pixel (tx, ty) */
+static uint32_t tui_image_color(const tui_image_cache* ic, int tx, int ty) {
+    size_t i = ((size_t)ty * (size_t)ic->width + (size_t)tx) * 3;
+    if (ic->dither == TUI_DITHER_FLOYD_STEINBERG) {
+        return TUI_RGB(ic->quant[i], ic->quant[i + 1], ic->quant[i + 2]);
+    }
+    if (ic->dither == TUI_DITHER_ORDERED) {
+        int bias = (tui_bayer4[ty & 3][tx & 3] * 2 - 15) * 40 / 32;
+        int rgb[3];
+        for (int ch = 0; ch < 3; ch++) {
+            int c = ic->pixels[i + ch] + bias;
+            rgb[ch] = tui_cube_levels[tui_cube_index(c < 0 ? 0 : (c > 255 ? 255 : c))];
+        }
+        return TUI_RGB(rgb[0], rgb[1], rgb[2]);
+    }
+    return TUI_RGB(ic->pixels[i], ic->pixels[i + 1], ic->pixels[i + 2]);
+}
+
+static void tui_image_draw(tui_widget* w, tui_context* ctx, int x, int y, int width, int height) {
+    const uint8_t* src = w->state.image.pixels;
+    int iw = w->state.image.img_width;
+    int ih = w->state.image.img_height;
+    int stride = w->state.image.stride > 0 ? w->state.image.stride : iw * 3;
+    if (!src || iw <= 0 || ih <= 0 || width <= 0 || height <= 0) return;
+    
+    tui_image_cache* ic = w->state.image.cache;
+    if (!ic) {
+        ic = (tui_image_cache*)calloc(1, sizeof(tui_image_cache));
+        if (!ic) return;
+        w->state.image.cache = ic;
+    }
+    
+    /* Fit the image into the widget, keeping its aspect ratio */
+    float scale = (float)width / (float)iw;
+    if ((float)(height * 2) / (float)ih < scale) scale = (float)(height * 2) / (float)ih;
+    int tw = (int)((float)iw * scale + 0.5f);
+    int th = (int)((float)ih * scale + 0.5f);
+    if (tw < 1) tw = 1;
+    if (th < 1) th = 1;
+    if (tw > width) tw = width;
+    if (th > height * 2) th = height * 2;
+    int rows = (th + 1) / 2;
+    
+    if (tw != ic->width || th != ic->height) {
+        if (!tui_image_layout(ic, tw, th)) return;
+    }
+    if (src != ic->source || iw != ic->src_width || ih != ic->src_height || stride != ic->stride) {
+        ic->source = src;
+        ic->src_width = iw;
+        ic->src_height = ih;
+        ic->stride = stride;
+        ic->stale = true;
+    }
+    int dither = (int)w->state.image.dither;
+    bool redither = dither != ic->dither || !ic->primed;
+    ic->dither = dither;
+    
+    if (ic->stale || redither) {
+        if (ic->stale) {
+            uint8_t* tmp = ic->prev;
+            ic->prev = ic->pixels;
+            ic->pixels = tmp;
+            tui_image_scale(ic, src, iw, ih, stride);
+        }
+        
+        /* Per-cell change detection on the scaled pixels */
+        bool any = redither;
+        for (int cy = 0; cy < rows; cy++) {
+            for (int cx = 0; cx < tw; cx++) {
+                size_t top = ((size_t)(2 * cy) * (size_t)tw + (size_t)cx) * 3;
+                size_t bottom = top + (size_t)tw * 3;
+                bool diff = redither || memcmp(ic->pixels + top, ic->prev + top, 3) != 0 ||
+                            (2 * cy + 1 < th && memcmp(ic->pixels + bottom, ic->prev + bottom, 3) != 0);
+                ic->changed[cy * tw + cx] = diff;
+                any |= diff;
+            }
+        }
+        
+        if (any && dither == TUI_DITHER_FLOYD_STEINBERG) {
+            tui_image_diffuse(ic);
+            memset(ic->changed, 1, (size_t)tw * (size_t)rows);
+        }
+        
+        for (int cy = 0; cy < rows && any; cy++) {
+            for (int cx = 0; cx < tw; cx++) {
+                if (!ic->changed[cy * tw + cx]) continue;
+                tui_cell* cell = &ic->cells[cy * tw + cx];
+                memset(cell, 0, sizeof(*cell));
+                cell->codepoint = 0x2580;  /* ▀: fg is the upper pixel */
+                cell->fg = tui_image_color(ic, cx, 2 * cy);
+                cell->bg = 2 * cy + 1 < th ? tui_image_color(ic, cx, 2 * cy + 1) : TUI_COLOR_DEFAULT;
+                cell->underline_color = TUI_COLOR_DEFAULT;
+                cell->style = TUI_STYLE_NONE;
+            }
         }
+        ic->stale = false;
+        ic->primed = true;
     }
     
-    if (select) {
-        *w->state.radio.group_value = w->state.radio.value;
-        return true;
+    /* Blit, centered and clipped */
+    int ox = x + (width - tw) / 2;
+    int oy = y + (height - rows) / 2;
+    int c0 = ox < ctx->clip_x0 ? ctx->clip_x0 - ox : 0;
+    int c1 = ox + tw > ctx->clip_x1 ? ctx->clip_x1 - ox : tw;
+    if (c0 >= c1) return;
+    for (int cy = 0; cy < rows; cy++) {
+        int sy = oy + cy;
+        if (sy < ctx->clip_y0 || sy >= ctx->clip_y1) continue;
+        memcpy(&ctx->back_buffer[sy * TUI_MAX_WIDTH + ox + c0], &ic->cells[cy * tw + c0],
+               (size_t)(c1 - c0) * sizeof(tui_cell));
     }
-    return false;
 }
 
-/* Handle list input */
-static bool tui_widget_handle_list_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+/* ============================================================================
+ * Scroll View
+ * ============================================================================ */
+
+/* Children are placed on a content_width x content_height canvas, offset by
+ * the scroll position (see tui_widget_get_absolute_bounds). Only children
+ * intersecting the viewport are drawn, clipped to it. With retain set the
+ * viewport cells are kept: scrolling by less than a screen shifts them and
+ * draws only the exposed rows, and an unchanged view is a plain copy. */
+
+static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx, tui_widget_manager* wm);
+
+static void tui_scrollview_clamp(tui_widget* w) {
+    int max_x = w->state.scrollview.content_width - w->width;
+    int max_y = w->state.scrollview.content_height - w->height;
+    int* sx = &w->state.scrollview.scroll_x;
+    int* sy = &w->state.scrollview.scroll_y;
+    if (*sx > max_x) *sx = max_x;
+    if (*sy > max_y) *sy = max_y;
+    if (*sx < 0) *sx = 0;
+    if (*sy < 0) *sy = 0;
+}
+
+void tui_scrollview_scroll_to(tui_widget* w, int x, int y) {
+    if (!w || w->type != TUI_WIDGET_SCROLLVIEW) return;
+    w->state.scrollview.scroll_x = x;
+    w->state.scrollview.scroll_y = y;
+    tui_scrollview_clamp(w);
+    tui_widget_invalidate(w);
+}
+
+void tui_scrollview_invalidate(tui_widget* w) {
+    if (w && w->type == TUI_WIDGET_SCROLLVIEW) w->state.scrollview.cache_valid = false;
+}
+
+/* A widget inside scroll views changed: drop their retained cells */
+static void tui_scrollview_invalidate_ancestors(tui_widget* w) {
+    for (tui_widget* p = w ? w->parent : NULL; p; p = p->parent) {
+        if (p->type == TUI_WIDGET_SCROLLVIEW) p->state.scrollview.cache_valid = false;
+    }
+}
+
+/* Scroll every enclosing scroll view so the widget is in view */
+static void tui_scrollview_reveal(tui_widget* w) {
+    if (!w) return;
+    int cx = w->x, cy = w->y;
+    for (tui_widget* p = w->parent; p; p = p->parent) {
+        if (p->type == TUI_WIDGET_SCROLLVIEW) {
+            int* sx = &p->state.scrollview.scroll_x;
+            int* sy = &p->state.scrollview.scroll_y;
+            if (cx + w->width > *sx + p->width) *sx = cx + w->width - p->width;
+            if (cy + w->height > *sy + p->height) *sy = cy + w->height - p->height;
+            if (cx < *sx) *sx = cx;
+            if (cy < *sy) *sy = cy;
+            tui_scrollview_clamp(p);
+            cx -= *sx;
+            cy -= *sy;
+        }
+        cx += p->x;
+        cy += p->y;
+    }
+}
+
+/* Draw the children meeting screen rows [top, top + rows), clipped to them */
+static void tui_scrollview_draw_band(tui_widget* w, tui_context* ctx, tui_widget_manager* wm,
+                                     int x, int y, int width, int top, int rows) {
+    int save_x0 = ctx->clip_x0, save_y0 = ctx->clip_y0;
+    int save_x1 = ctx->clip_x1, save_y1 = ctx->clip_y1;
     
-    int* sel = &w->state.list.selected;
-    int* scr = &w->state.list.scroll;
-    int count = w->state.list.count;
-    int visible = w->state.list.visible;
+    if (x > ctx->clip_x0) ctx->clip_x0 = x;
+    if (top > ctx->clip_y0) ctx->clip_y0 = top;
+    if (x + width < ctx->clip_x1) ctx->clip_x1 = x + width;
+    if (top + rows < ctx->clip_y1) ctx->clip_y1 = top + rows;
     
-    if (e->base.type == TUI_EVENT_KEY) {
-        switch (e->base.key) {
-            case TUI_KEY_UP:
-                if (*sel > 0) {
-                    (*sel)--;
-                    if (*sel < *scr) *scr = *sel;
+    if (ctx->clip_x0 < ctx->clip_x1 && ctx->clip_y0 < ctx->clip_y1) {
+        /* Screen position of the content origin */
+        int ox = x - w->state.scrollview.scroll_x;
+        int oy = y - w->state.scrollview.scroll_y;
+        
+        for (int i = 0; i < w->child_count; i++) {
+            tui_widget* c = w->children[i];
+            if (!c->visible) continue;
+            
+            /* Cull children outside the band */
+            if (oy + c->y + c->height <= ctx->clip_y0 || oy + c->y >= ctx->clip_y1) continue;
+            if (ox + c->x + c->width <= ctx->clip_x0 || ox + c->x >= ctx->clip_x1) continue;
+            tui_widget_draw_recursive(c, ctx, wm);
+        }
+    }
+    
+    ctx->clip_x0 = save_x0;
+    ctx->clip_y0 = save_y0;
+    ctx->clip_x1 = save_x1;
+    ctx->clip_y1 = save_y1;
+}
+
+static void tui_scrollview_capture(tui_widget* w, tui_context* ctx, int x, int y, int top, int rows) {
+    int width = w->state.scrollview.cache_width;
+    for (int r = top; r < top + rows; r++) {
+        memcpy(&w->state.scrollview.cache[r * width], &ctx->back_buffer[(y + r) * TUI_MAX_WIDTH + x],
+               (size_t)width * sizeof(tui_cell));
+    }
+}
+
+/* Whether a widget inside the view owns an overlay (which its draw must re-request) */
+static bool tui_scrollview_has_overlay(tui_widget* w, tui_widget_manager* wm) {
+    for (int i = 0; wm && i < wm->overlay_count; i++) {
+        for (tui_widget* p = wm->overlays[i].owner->parent; p; p = p->parent) {
+            if (p == w) return true;
+        }
+    }
+    return false;
+}
+
+static void tui_scrollview_draw(tui_widget* w, tui_context* ctx, tui_widget_manager* wm,
+                                int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) return;
+    tui_scrollview_clamp(w);
+    
+    /* Retaining needs the whole viewport on screen and unclipped, and no
+     * descendant overlay open: cached rows would skip the owner's draw */
+    bool whole = x >= ctx->clip_x0 && y >= ctx->clip_y0 &&
+                 x + width <= ctx->clip_x1 && y + height <= ctx->clip_y1;
+    if (!w->state.scrollview.retain || !whole || tui_scrollview_has_overlay(w, wm)) {
+        w->state.scrollview.cache_valid = false;
+        tui_scrollview_draw_band(w, ctx, wm, x, y, width, y, height);
+        return;
+    }
+    
+    if (w->state.scrollview.cache_width != width || w->state.scrollview.cache_height != height) {
+        tui_cell* cache = (tui_cell*)realloc(w->state.scrollview.cache,
+                                             (size_t)width * (size_t)height * sizeof(tui_cell));
+        if (!cache) {
+            tui_scrollview_draw_band(w, ctx, wm, x, y, width, y, height);
+            return;
+        }
+        w->state.scrollview.cache = cache;
+        w->state.scrollview.cache_width = width;
+        w->state.scrollview.cache_height = height;
+        w->state.scrollview.cache_valid = false;
+    }
+    
+    tui_cell* cache = w->state.scrollview.cache;
+    int sx = w->state.scrollview.scroll_x;
+    int sy = w->state.scrollview.scroll_y;
+    int dy = sy - w->state.scrollview.cache_y;
+    
+    if (!w->state.scrollview.cache_valid || sx != w->state.scrollview.cache_x ||
+        dy >= height || -dy >= height) {
+        tui_scrollview_draw_band(w, ctx, wm, x, y, width, y, height);
+        tui_scrollview_capture(w, ctx, x, y, 0, height);
+    } else {
+        /* Shift the kept rows and draw only the exposed ones */
+        int keep = height - (dy > 0 ? dy : -dy);
+        if (dy > 0) {
+            memmove(cache, cache + (size_t)dy * (size_t)width, (size_t)keep * (size_t)width * sizeof(tui_cell));
+        } else if (dy < 0) {
+            memmove(cache + (size_t)(-dy) * (size_t)width, cache, (size_t)keep * (size_t)width * sizeof(tui_cell));
+        }
+        if (dy != 0) {
+            int top = dy > 0 ? keep : 0;
+            tui_scrollview_draw_band(w, ctx, wm, x, y, width, y + top, height - keep);
+            tui_scrollview_capture(w, ctx, x, y, top, height - keep);
+        }
+        
+        int first = dy < 0 ? -dy : 0;
+        for (int r = first; r < first + keep; r++) {
+            memcpy(&ctx->back_buffer[(y + r) * TUI_MAX_WIDTH + x], &cache[r * width],
+                   (size_t)width * sizeof(tui_cell));
+        }
+    }
+    
+    w->state.scrollview.cache_x = sx;
+    w->state.scrollview.cache_y = sy;
+    w->state.scrollview.cache_valid = true;
+}
+
+/* Wheel and paging on the view itself */
+static bool tui_widget_handle_scrollview_input(tui_widget* w, tui_widget_event* e) {
+    int sx = w->state.scrollview.scroll_x;
+    int sy = w->state.scrollview.scroll_y;
+    int page = w->height > 1 ? w->height - 1 : 1;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        switch (e->base.key) {
+            case TUI_KEY_UP:       sy--; break;
+            case TUI_KEY_DOWN:     sy++; break;
+            case TUI_KEY_LEFT:     sx--; break;
+            case TUI_KEY_RIGHT:    sx++; break;
+            case TUI_KEY_PAGEUP:   sy -= page; break;
+            case TUI_KEY_PAGEDOWN: sy += page; break;
+            case TUI_KEY_HOME:     sy = 0; break;
+            case TUI_KEY_END:      sy = w->state.scrollview.content_height; break;
+            default:               return false;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_WHEEL_UP) sy -= 3;
+        else if (e->base.mouse_button == TUI_MOUSE_WHEEL_DOWN) sy += 3;
+        else return false;
+#endif
+    } else {
+        return false;
+    }
+    
+    tui_scrollview_scroll_to(w, sx, sy);
+    return true;
+}
+
+/* ============================================================================
+ * Progressive Drawing
+ * ============================================================================ */
+
+/* A widget with a step function keeps its cells between frames. Each frame
+ * shows the kept cells and then runs further passes while the manager's
+ * budget lasts, so a rebuild paints over the previous content and finishes
+ * over several frames. tui_widget_invalidate restarts it at pass 0, as does
+ * exposing part of the widget the passes never drew (they run clipped). */
+struct tui_step_state {
+    tui_cell* cells;
+    int width;
+    int height;
+    int pass;                   /* Next pass to run */
+    bool complete;
+    int seen_x0, seen_y0;       /* Widget-relative area the passes drew into */
+    int seen_x1, seen_y1;
+};
+
+static void tui_step_state_free(tui_step_state* st) {
+    if (!st) return;
+    free(st->cells);
+    free(st);
+}
+
+/* Monotonic microseconds, so clock adjustments can't stretch or cut a budget */
+static int64_t tui_now_us(void) {
+#ifdef TUI_PLATFORM_WINDOWS
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (int64_t)(count.QuadPart / freq.QuadPart * 1000000 +
+                     count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+void tui_widget_set_step(tui_widget* w, tui_widget_step_fn step) {
+    if (!w) return;
+    w->step_fn = step;
+    tui_widget_invalidate(w);
+}
+
+static void tui_widget_draw_steps(tui_widget* w, tui_context* ctx, tui_widget_manager* wm,
+                                  int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) return;
+    
+    tui_step_state* st = w->step;
+    if (!st || st->width != width || st->height != height) {
+        if (!st) {
+            st = (tui_step_state*)calloc(1, sizeof(tui_step_state));
+            if (!st) return;
+            w->step = st;
+        }
+        tui_cell* cells = (tui_cell*)realloc(st->cells, (size_t)width * (size_t)height * sizeof(tui_cell));
+        if (!cells) return;
+        st->cells = cells;
+        st->width = width;
+        st->height = height;
+        tui_cell empty = tui_make_empty_cell();
+        for (int i = 0; i < width * height; i++) {
+            st->cells[i] = empty;
+        }
+        st->pass = 0;
+        st->complete = false;
+    }
+    
+    /* Visible part of the widget */
+    int x0 = x > ctx->clip_x0 ? x : ctx->clip_x0;
+    int y0 = y > ctx->clip_y0 ? y : ctx->clip_y0;
+    int x1 = x + width < ctx->clip_x1 ? x + width : ctx->clip_x1;
+    int y1 = y + height < ctx->clip_y1 ? y + height : ctx->clip_y1;
+    if (x0 >= x1 || y0 >= y1) return;
+    
+    /* Cells outside the area the passes covered were never drawn */
+    if (st->pass == 0 || x0 - x < st->seen_x0 || y0 - y < st->seen_y0 ||
+        x1 - x > st->seen_x1 || y1 - y > st->seen_y1) {
+        st->pass = 0;
+        st->complete = false;
+        st->seen_x0 = x0 - x;
+        st->seen_y0 = y0 - y;
+        st->seen_x1 = x1 - x;
+        st->seen_y1 = y1 - y;
+    }
+    
+    /* Kept cells first */
+    for (int row = y0; row < y1; row++) {
+        memcpy(&ctx->back_buffer[row * TUI_MAX_WIDTH + x0], &st->cells[(row - y) * width + (x0 - x)],
+               (size_t)(x1 - x0) * sizeof(tui_cell));
+    }
+    if (st->complete) return;
+    
+    /* Passes while the budget lasts, at least one per frame */
+    int save_x0 = ctx->clip_x0, save_y0 = ctx->clip_y0;
+    int save_x1 = ctx->clip_x1, save_y1 = ctx->clip_y1;
+    ctx->clip_x0 = x0;
+    ctx->clip_y0 = y0;
+    ctx->clip_x1 = x1;
+    ctx->clip_y1 = y1;
+    do {
+        st->complete = w->step_fn(w, ctx, st->pass++);
+    } while (!st->complete &&
+             (!wm || wm->step_deadline == 0 || tui_now_us() < wm->step_deadline));
+    ctx->clip_x0 = save_x0;
+    ctx->clip_y0 = save_y0;
+    ctx->clip_x1 = save_x1;
+    ctx->clip_y1 = save_y1;
+    
+    for (int row = y0; row < y1; row++) {
+        memcpy(&st->cells[(row - y) * width + (x0 - x)], &ctx->back_buffer[row * TUI_MAX_WIDTH + x0],
+               (size_t)(x1 - x0) * sizeof(tui_cell));
+    }
+    
+    /* Still filling in: stay dirty without restarting */
+    if (!st->complete) {
+        for (tui_widget* p = w; p; p = p->parent) {
+            p->dirty = true;
+        }
+        tui_scrollview_invalidate_ancestors(w);
+        if (wm) wm->steps_pending = true;
+    }
+}
+
+bool tui_wm_draw_budgeted(tui_widget_manager* wm, tui_context* ctx, int budget_us) {
+    if (!wm) return true;
+    wm->step_deadline = tui_now_us() + (budget_us > 0 ? budget_us : 1);
+    wm->steps_pending = false;
+    tui_wm_draw(wm, ctx);
+    wm->step_deadline = 0;
+    return !wm->steps_pending;
+}
+
+/* ============================================================================
+ * Data Binding
+ * ============================================================================ */
+
+/* A value cell knows the widgets bound to it. A write that changes it bumps
+ * the version and marks those widgets (and their ancestors) dirty; a widget
+ * pulls the new value into its state the next time it is drawn. */
+struct tui_value {
+    tui_value_type type;
+    uint32_t version;
+    int i;
+    float f;
+    char* str;                  /* STRING (owned copy) */
+    char** items;               /* LIST (owned copies) */
+    int count;
+    int capacity;
+    tui_widget** dependents;
+    int dependent_count;
+    int dependent_capacity;
+};
+
+void tui_widget_invalidate(tui_widget* w) {
+    if (w && w->step) {
+        w->step->pass = 0;
+        w->step->complete = false;
+    }
+    for (tui_widget* p = w; p; p = p->parent) {
+        p->dirty = true;
+    }
+    tui_scrollview_invalidate_ancestors(w);
+}
+
+bool tui_wm_is_dirty(tui_widget_manager* wm) {
+    if (!wm) return false;
+    return (wm->root && wm->root->dirty) || (wm->damage_w > 0 && wm->damage_h > 0);
+}
+
+static void tui_widget_pull_binding(tui_widget* w);
+
+/* Drop state borrowed from a value that is going away (its strings/items) */
+static void tui_widget_release_binding(tui_widget* w) {
+    switch (w->type) {
+        case TUI_WIDGET_LABEL:  w->state.label.text = NULL; break;
+        case TUI_WIDGET_BUTTON: w->state.button.text = NULL; break;
+        case TUI_WIDGET_LIST:
+            w->state.list.items = NULL;
+            w->state.list.count = 0;
+            break;
+        case TUI_WIDGET_DROPDOWN:
+            w->state.dropdown.items = NULL;
+            w->state.dropdown.count = 0;
+            break;
+        case TUI_WIDGET_TABS:
+            w->state.tabs.labels = NULL;
+            w->state.tabs.count = 0;
+            break;
+        default:
+            return;
+    }
+    tui_widget_invalidate(w);
+}
+
+static tui_value* tui_value_create(tui_value_type type) {
+    tui_value* v = (tui_value*)calloc(1, sizeof(tui_value));
+    if (v) v->type = type;
+    return v;
+}
+
+tui_value* tui_value_create_int(int value) {
+    tui_value* v = tui_value_create(TUI_VALUE_INT);
+    if (v) v->i = value;
+    return v;
+}
+
+tui_value* tui_value_create_float(float value) {
+    tui_value* v = tui_value_create(TUI_VALUE_FLOAT);
+    if (v) v->f = value;
+    return v;
+}
+
+tui_value* tui_value_create_string(const char* value) {
+    tui_value* v = tui_value_create(TUI_VALUE_STRING);
+    if (v && !tui_value_set_string(v, value)) {
+        free(v);
+        return NULL;
+    }
+    return v;
+}
+
+tui_value* tui_value_create_list(void) {
+    return tui_value_create(TUI_VALUE_LIST);
+}
+
+void tui_value_destroy(tui_value* v) {
+    if (!v) return;
+    for (int i = 0; i < v->dependent_count; i++) {
+        v->dependents[i]->binding = NULL;
+        tui_widget_release_binding(v->dependents[i]);
+    }
+    for (int i = 0; i < v->count; i++) {
+        free(v->items[i]);
+    }
+    free(v->items);
+    free(v->str);
+    free(v->dependents);
+    free(v);
+}
+
+static void tui_value_changed(tui_value* v) {
+    v->version++;
+    for (int i = 0; i < v->dependent_count; i++) {
+        /* Strings and lists may have been reallocated: re-point dependents now */
+        if (v->type == TUI_VALUE_STRING || v->type == TUI_VALUE_LIST) {
+            tui_widget_pull_binding(v->dependents[i]);
+        }
+        tui_widget_invalidate(v->dependents[i]);
+    }
+}
+
+uint32_t tui_value_version(const tui_value* v) {
+    return v ? v->version : 0;
+}
+
+void tui_value_set_int(tui_value* v, int value) {
+    if (!v) return;
+    if (v->type == TUI_VALUE_FLOAT) {
+        tui_value_set_float(v, (float)value);
+    } else if (v->type == TUI_VALUE_INT && v->i != value) {
+        v->i = value;
+        tui_value_changed(v);
+    }
+}
+
+void tui_value_set_float(tui_value* v, float value) {
+    if (!v) return;
+    if (v->type == TUI_VALUE_INT) {
+        tui_value_set_int(v, (int)value);
+    } else if (v->type == TUI_VALUE_FLOAT && v->f != value) {
+        v->f = value;
+        tui_value_changed(v);
+    }
+}
+
+bool tui_value_set_string(tui_value* v, const char* value) {
+    if (!v || v->type != TUI_VALUE_STRING) return false;
+    if (!value) value = "";
+    if (v->str && strcmp(v->str, value) == 0) return true;
+    
+    size_t len = strlen(value);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return false;
+    memcpy(copy, value, len + 1);
+    free(v->str);
+    v->str = copy;
+    tui_value_changed(v);
+    return true;
+}
+
+int tui_value_get_int(const tui_value* v) {
+    if (!v) return 0;
+    return v->type == TUI_VALUE_FLOAT ? (int)v->f : v->i;
+}
+
+float tui_value_get_float(const tui_value* v) {
+    if (!v) return 0.0f;
+    return v->type == TUI_VALUE_INT ? (float)v->i : v->f;
+}
+
+const char* tui_value_get_string(const tui_value* v) {
+    return v && v->type == TUI_VALUE_STRING && v->str ? v->str : "";
+}
+
+bool tui_value_list_insert(tui_value* v, int index, const char* item) {
+    if (!v || v->type != TUI_VALUE_LIST) return false;
+    if (index < 0 || index > v->count) index = v->count;
+    
+    if (v->count >= v->capacity) {
+        int cap = v->capacity ? v->capacity * 2 : 16;
+        char** items = (char**)realloc(v->items, (size_t)cap * sizeof(char*));
+        if (!items) return false;
+        v->items = items;
+        v->capacity = cap;
+    }
+    
+    size_t len = item ? strlen(item) : 0;
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return false;
+    if (len) memcpy(copy, item, len);
+    copy[len] = '\0';
+    
+    memmove(&v->items[index + 1], &v->items[index], (size_t)(v->count - index) * sizeof(char*));
+    v->items[index] = copy;
+    v->count++;
+    tui_value_changed(v);
+    return true;
+}
+
+bool tui_value_list_set(tui_value* v, int index, const char* item) {
+    if (!v || v->type != TUI_VALUE_LIST || index < 0 || index >= v->count) return false;
+    if (!item) item = "";
+    if (strcmp(v->items[index], item) == 0) return true;
+    
+    size_t len = strlen(item);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return false;
+    memcpy(copy, item, len + 1);
+    free(v->items[index]);
+    v->items[index] = copy;
+    tui_value_changed(v);
+    return true;
+}
+
+void tui_value_list_remove(tui_value* v, int index) {
+    if (!v || v->type != TUI_VALUE_LIST || index < 0 || index >= v->count) return;
+    free(v->items[index]);
+    memmove(&v->items[index], &v->items[index + 1], (size_t)(v->count - index - 1) * sizeof(char*));
+    v->count--;
+    tui_value_changed(v);
+}
+
+void tui_value_list_clear(tui_value* v) {
+    if (!v || v->type != TUI_VALUE_LIST || v->count == 0) return;
+    for (int i = 0; i < v->count; i++) {
+        free(v->items[i]);
+    }
+    v->count = 0;
+    tui_value_changed(v);
+}
+
+int tui_value_list_count(const tui_value* v) {
+    return v && v->type == TUI_VALUE_LIST ? v->count : 0;
+}
+
+const char* tui_value_list_get(const tui_value* v, int index) {
+    if (!v || v->type != TUI_VALUE_LIST || index < 0 || index >= v->count) return NULL;
+    return v->items[index];
+}
+
+/* Which value types a widget can show */
+static bool tui_binding_accepts(tui_widget_type wt, tui_value_type vt) {
+    bool numeric = vt == TUI_VALUE_INT || vt == TUI_VALUE_FLOAT;
+    switch (wt) {
+        case TUI_WIDGET_LABEL:
+        case TUI_WIDGET_BUTTON:
+            return vt == TUI_VALUE_STRING;
+        case TUI_WIDGET_PROGRESS:
+        case TUI_WIDGET_SLIDER:
+        case TUI_WIDGET_SPINNER:
+        case TUI_WIDGET_CHECKBOX:
+            return numeric;
+        case TUI_WIDGET_LIST:
+        case TUI_WIDGET_DROPDOWN:
+        case TUI_WIDGET_TABS:
+            return vt == TUI_VALUE_LIST;
+        default:
+            return false;
+    }
+}
+
+void tui_widget_unbind(tui_widget* w) {
+    if (!w || !w->binding) return;
+    tui_value* v = w->binding;
+    for (int i = 0; i < v->dependent_count; i++) {
+        if (v->dependents[i] == w) {
+            v->dependents[i] = v->dependents[--v->dependent_count];
+            break;
+        }
+    }
+    w->binding = NULL;
+    tui_widget_release_binding(w);
+}
+
+bool tui_widget_bind(tui_widget* w, tui_value* v) {
+    if (!w) return false;
+    if (v && !tui_binding_accepts(w->type, v->type)) return false;
+    tui_widget_unbind(w);
+    if (!v) return true;
+    
+    if (v->dependent_count >= v->dependent_capacity) {
+        int cap = v->dependent_capacity ? v->dependent_capacity * 2 : 4;
+        tui_widget** deps = (tui_widget**)realloc(v->dependents, (size_t)cap * sizeof(tui_widget*));
+        if (!deps) return false;
+        v->dependents = deps;
+        v->dependent_capacity = cap;
+    }
+    v->dependents[v->dependent_count++] = w;
+    w->binding = v;
+    w->binding_version = v->version - 1;  /* Pull on the next draw */
+    tui_widget_invalidate(w);
+    return true;
+}
+
+/* Copy the bound value into the widget's state */
+static void tui_widget_pull_binding(tui_widget* w) {
+    tui_value* v = w->binding;
+    w->binding_version = v->version;
+    
+    switch (w->type) {
+        case TUI_WIDGET_LABEL:    w->state.label.text = tui_value_get_string(v); break;
+        case TUI_WIDGET_BUTTON:   w->state.button.text = tui_value_get_string(v); break;
+        case TUI_WIDGET_PROGRESS: w->state.progress.value = tui_value_get_float(v); break;
+        case TUI_WIDGET_SLIDER:   w->state.slider.value = tui_value_get_float(v); break;
+        case TUI_WIDGET_SPINNER:  w->state.spinner.value = tui_value_get_int(v); break;
+        case TUI_WIDGET_CHECKBOX: w->state.checkbox.checked = tui_value_get_int(v) != 0; break;
+        case TUI_WIDGET_LIST:
+            w->state.list.items = (const char**)v->items;
+            w->state.list.count = v->count;
+            if (w->state.list.selected >= v->count) w->state.list.selected = v->count - 1;
+            break;
+        case TUI_WIDGET_DROPDOWN:
+            w->state.dropdown.items = (const char**)v->items;
+            w->state.dropdown.count = v->count;
+            if (w->state.dropdown.selected >= v->count) w->state.dropdown.selected = v->count - 1;
+            break;
+        case TUI_WIDGET_TABS:
+            w->state.tabs.labels = (const char**)v->items;
+            w->state.tabs.count = v->count;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Input changed an editable widget: write its state back to the value */
+static void tui_widget_push_binding(tui_widget* w) {
+    tui_value* v = w->binding;
+    if (!v) return;
+    
+    switch (w->type) {
+        case TUI_WIDGET_SLIDER:   tui_value_set_float(v, w->state.slider.value); break;
+        case TUI_WIDGET_SPINNER:  tui_value_set_int(v, w->state.spinner.value); break;
+        case TUI_WIDGET_CHECKBOX: tui_value_set_int(v, w->state.checkbox.checked ? 1 : 0); break;
+        default:                  return;
+    }
+    w->binding_version = v->version;
+}
+
+/* ============================================================================
+ * Default Widget Input Handling
+ * ============================================================================ */
+
+bool tui_textbox_insert(tui_widget* w, int pos, const char* bytes, int len) {
+    if (!w || w->type != TUI_WIDGET_TEXTBOX || !w->state.textbox.buffer || !bytes) return false;
+    
+    char* buf = w->state.textbox.buffer;
+    int length = w->state.textbox.length;
+    if (pos < 0 || pos > length || len < 0) return false;
+    if (len > w->state.textbox.capacity - 1 - length) return false;
+    
+    /* Open the gap once, then copy; line breaks become spaces */
+    memmove(buf + pos + len, buf + pos, (size_t)(length - pos) + 1);
+    for (int i = 0; i < len; i++) {
+        char c = bytes[i];
+        buf[pos + i] = (c == '\n' || c == '\r') ? ' ' : c;
+    }
+    w->state.textbox.length = length + len;
+    if (w->state.textbox.cursor >= pos) w->state.textbox.cursor += len;
+    return true;
+}
+
+/* Handle textbox input */
+static bool tui_widget_handle_textbox_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e || e->base.type != TUI_EVENT_KEY) return false;
+    if (!w->state.textbox.buffer) return false;
+    
+    char* buf = w->state.textbox.buffer;
+    int cap = w->state.textbox.capacity;
+    int* len = &w->state.textbox.length;
+    int* cursor = &w->state.textbox.cursor;
+    
+    tui_key key = e->base.key;
+    uint32_t ch = e->base.ch;
+    
+    switch (key) {
+        case TUI_KEY_LEFT:
+            if (*cursor > 0) (*cursor)--;
+            return true;
+            
+        case TUI_KEY_RIGHT:
+            if (*cursor < *len) (*cursor)++;
+            return true;
+            
+        case TUI_KEY_HOME:
+            *cursor = 0;
+            return true;
+            
+        case TUI_KEY_END:
+            *cursor = *len;
+            return true;
+            
+        case TUI_KEY_BACKSPACE:
+            if (*cursor > 0) {
+                memmove(buf + *cursor - 1, buf + *cursor, (size_t)(*len - *cursor + 1));
+                (*cursor)--;
+                (*len)--;
+            }
+            return true;
+            
+        case TUI_KEY_DELETE:
+            if (*cursor < *len) {
+                memmove(buf + *cursor, buf + *cursor + 1, (size_t)(*len - *cursor));
+                (*len)--;
+            }
+            return true;
+            
+        case TUI_KEY_CHAR:
+            if (ch >= 32 && ch < 127 && *len < cap - 1) {
+                memmove(buf + *cursor + 1, buf + *cursor, (size_t)(*len - *cursor + 1));
+                buf[*cursor] = (char)ch;
+                (*cursor)++;
+                (*len)++;
+            }
+            return true;
+            
+        case TUI_KEY_SPACE:
+            /* Space character for text input */
+            if (*len < cap - 1) {
+                memmove(buf + *cursor + 1, buf + *cursor, (size_t)(*len - *cursor + 1));
+                buf[*cursor] = ' ';
+                (*cursor)++;
+                (*len)++;
+            }
+            return true;
+            
+        default:
+            break;
+    }
+    return false;
+}
+
+/* Handle checkbox input */
+static bool tui_widget_handle_checkbox_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    bool toggle = false;
+    if (e->base.type == TUI_EVENT_KEY) {
+        if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
+            toggle = true;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            toggle = true;
+        }
+#endif
+    }
+    
+    if (toggle) {
+        w->state.checkbox.checked = !w->state.checkbox.checked;
+        return true;
+    }
+    return false;
+}
+
+/* Handle radio button input */
+static bool tui_widget_handle_radio_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e || !w->state.radio.group_value) return false;
+    
+    bool select = false;
+    if (e->base.type == TUI_EVENT_KEY) {
+        if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
+            select = true;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            select = true;
+        }
+#endif
+    }
+    
+    if (select) {
+        *w->state.radio.group_value = w->state.radio.value;
+        return true;
+    }
+    return false;
+}
+
+/* Handle list input */
+static bool tui_widget_handle_list_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    int* sel = &w->state.list.selected;
+    int* scr = &w->state.list.scroll;
+    int count = w->state.list.count;
+    int visible = w->state.list.visible;
+    
+    int* anchor = &w->state.list.anchor;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        /* Ctrl+A selects every row: the range is just its two ends */
+        if (e->base.ctrl && e->base.key == TUI_KEY_CHAR && e->base.ch == 'a') {
+            if (count <= 0) return false;
+            *anchor = 0;
+            *sel = count - 1;
+            return true;
+        }
+        
+        /* Shift+movement extends a range from the anchor; plain movement drops it */
+        switch (e->base.key) {
+            case TUI_KEY_UP:
+            case TUI_KEY_DOWN:
+            case TUI_KEY_PAGEUP:
+            case TUI_KEY_PAGEDOWN:
+            case TUI_KEY_HOME:
+            case TUI_KEY_END:
+                if (!e->base.shift) *anchor = -1;
+                else if (*anchor < 0) *anchor = *sel;
+                break;
+            default:
+                break;
+        }
+        
+        switch (e->base.key) {
+            case TUI_KEY_UP:
+                if (*sel > 0) {
+                    (*sel)--;
+                    if (*sel < *scr) *scr = *sel;
                 }
                 return true;
                 
@@ -3322,6 +6967,7 @@ static bool tui_widget_handle_list_input(tui_widget* w, tui_widget_event* e) {
             default:
                 break;
         }
+#ifndef TUI_NO_MOUSE
     } else if (e->base.type == TUI_EVENT_MOUSE) {
         if (e->base.mouse_button == TUI_MOUSE_LEFT) {
             int ax, ay, aw, ah;
@@ -3329,248 +6975,1500 @@ static bool tui_widget_handle_list_input(tui_widget* w, tui_widget_event* e) {
             int clicked_row = e->base.mouse_y - ay;
             int clicked_item = *scr + clicked_row;
             if (clicked_item >= 0 && clicked_item < count) {
+                if (!e->base.shift) *anchor = -1;
+                else if (*anchor < 0) *anchor = *sel;
                 *sel = clicked_item;
                 return true;
             }
         } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_UP) {
-            if (*scr > 0) (*scr)--;
+            if (*scr > 0) (*scr)--;
+            return true;
+        } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_DOWN) {
+            int max_scroll = count - visible;
+            if (max_scroll < 0) max_scroll = 0;
+            if (*scr < max_scroll) (*scr)++;
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+void tui_list_select_range(tui_widget* w, int anchor, int cursor) {
+    if (!w || w->type != TUI_WIDGET_LIST || w->state.list.count <= 0) return;
+    int count = w->state.list.count;
+    if (cursor < 0) cursor = 0;
+    if (cursor >= count) cursor = count - 1;
+    if (anchor >= count) anchor = count - 1;
+    
+    w->state.list.anchor = anchor;
+    w->state.list.selected = cursor;
+    
+    /* Keep the cursor in view */
+    int visible = w->state.list.visible > 0 ? w->state.list.visible : w->height;
+    if (cursor < w->state.list.scroll) w->state.list.scroll = cursor;
+    if (visible > 0 && cursor >= w->state.list.scroll + visible) w->state.list.scroll = cursor - visible + 1;
+}
+
+int tui_list_get_selection(tui_widget* w, int* first, int* last) {
+    if (!w || w->type != TUI_WIDGET_LIST) return 0;
+    int count = w->state.list.count;
+    int sel = w->state.list.selected;
+    if (count <= 0 || sel < 0 || sel >= count) return 0;
+    
+    int anchor = w->state.list.anchor;
+    if (anchor < 0) anchor = sel;
+    if (anchor >= count) anchor = count - 1;
+    int lo = anchor < sel ? anchor : sel;
+    int hi = anchor < sel ? sel : anchor;
+    if (first) *first = lo;
+    if (last) *last = hi;
+    return hi - lo + 1;
+}
+
+tui_clipboard_status tui_list_copy_selection(tui_context* ctx, tui_widget* w) {
+    if (!ctx || !w || w->type != TUI_WIDGET_LIST) return TUI_CLIPBOARD_INVALID;
+    int first, last;
+    const char** items = w->state.list.items;
+    const tui_str* ids = ctx->strings ? w->state.list.item_ids : NULL;
+    if (!tui_list_get_selection(w, &first, &last) || (!items && !ids)) return TUI_CLIPBOARD_OK;
+    
+    /* Measure first so the limit is checked before anything is sent */
+    size_t total = (size_t)(last - first);
+    for (int i = first; i <= last; i++) {
+        if (ids) total += (size_t)tui_str_len(ctx->strings, ids[i]);
+        else if (items[i]) total += strlen(items[i]);
+    }
+    
+    tui_clipboard_status status = tui_clipboard_begin(ctx, total);
+    if (status != TUI_CLIPBOARD_OK) return status;
+    for (int i = first; i <= last; i++) {
+        if (ids) tui_clipboard_write(ctx, tui_str_text(ctx->strings, ids[i]), (size_t)tui_str_len(ctx->strings, ids[i]));
+        else if (items[i]) tui_clipboard_write(ctx, items[i], strlen(items[i]));
+        if (i < last) tui_clipboard_write(ctx, "\n", 1);
+    }
+    return tui_clipboard_end(ctx);
+}
+
+/* Handle slider input */
+static bool tui_widget_handle_slider_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    float* val = &w->state.slider.value;
+    float min = w->state.slider.min;
+    float max = w->state.slider.max;
+    float step = w->state.slider.step;
+    if (step <= 0) step = (max - min) / 20.0f;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        switch (e->base.key) {
+            case TUI_KEY_LEFT:
+            case TUI_KEY_DOWN:
+                *val -= step;
+                if (*val < min) *val = min;
+                return true;
+                
+            case TUI_KEY_RIGHT:
+            case TUI_KEY_UP:
+                *val += step;
+                if (*val > max) *val = max;
+                return true;
+                
+            case TUI_KEY_HOME:
+                *val = min;
+                return true;
+                
+            case TUI_KEY_END:
+                *val = max;
+                return true;
+                
+            default:
+                break;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            int ax, ay, aw, ah;
+            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
+            float ratio = (float)(e->base.mouse_x - ax) / (float)(aw - 1);
+            if (ratio < 0) ratio = 0;
+            if (ratio > 1) ratio = 1;
+            *val = min + ratio * (max - min);
+            w->state.slider.dragging = true;
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+/* Handle spinner input */
+static bool tui_widget_handle_spinner_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    int* val = &w->state.spinner.value;
+    int min = w->state.spinner.min;
+    int max = w->state.spinner.max;
+    int step = w->state.spinner.step;
+    if (step <= 0) step = 1;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        switch (e->base.key) {
+            case TUI_KEY_LEFT:
+            case TUI_KEY_DOWN:
+                *val -= step;
+                if (*val < min) *val = min;
+                return true;
+                
+            case TUI_KEY_RIGHT:
+            case TUI_KEY_UP:
+                *val += step;
+                if (*val > max) *val = max;
+                return true;
+                
+            default:
+                break;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            int ax, ay, aw, ah;
+            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
+            /* Left third = decrement, right third = increment */
+            int rel_x = e->base.mouse_x - ax;
+            if (rel_x < aw / 3) {
+                *val -= step;
+                if (*val < min) *val = min;
+            } else if (rel_x > 2 * aw / 3) {
+                *val += step;
+                if (*val > max) *val = max;
+            }
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+/* Handle dropdown input */
+static bool tui_widget_handle_dropdown_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    bool* open = &w->state.dropdown.open;
+    int* sel = &w->state.dropdown.selected;
+    int count = w->state.dropdown.count;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        if (*open) {
+            switch (e->base.key) {
+                case TUI_KEY_UP:
+                    if (*sel > 0) (*sel)--;
+                    return true;
+                case TUI_KEY_DOWN:
+                    if (*sel < count - 1) (*sel)++;
+                    return true;
+                case TUI_KEY_ENTER:
+                case TUI_KEY_SPACE:
+                    *open = false;
+                    return true;
+                case TUI_KEY_ESC:
+                    *open = false;
+                    return true;
+                default:
+                    break;
+            }
+        } else {
+            if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
+                *open = true;
+                return true;
+            }
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            if (*open) {
+                int ax, ay, aw, ah;
+                tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
+                int clicked_row = e->base.mouse_y - ay - 1;
+                if (clicked_row >= 0 && clicked_row < count && clicked_row < 5) {
+                    *sel = w->state.dropdown.scroll + clicked_row;
+                    *open = false;
+                } else {
+                    *open = false;
+                }
+            } else {
+                *open = true;
+            }
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+/* Handle tabs input */
+static bool tui_widget_handle_tabs_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    int* sel = &w->state.tabs.selected;
+    int count = w->state.tabs.count;
+    
+    if (e->base.type == TUI_EVENT_KEY) {
+        switch (e->base.key) {
+            case TUI_KEY_LEFT:
+                if (*sel > 0) (*sel)--;
+                return true;
+            case TUI_KEY_RIGHT:
+                if (*sel < count - 1) (*sel)++;
+                return true;
+            default:
+                break;
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            /* Calculate which tab was clicked */
+            int ax, ay, aw, ah;
+            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
+            int rel_x = e->base.mouse_x - ax;
+            int tab_x = 0;
+            for (int i = 0; i < count; i++) {
+                int tab_width = w->state.tabs.labels[i] ? 
+                    (int)strlen(w->state.tabs.labels[i]) + 2 : 4;
+                if (rel_x >= tab_x && rel_x < tab_x + tab_width) {
+                    *sel = i;
+                    return true;
+                }
+                tab_x += tab_width + 1; /* +1 for separator */
+            }
+        }
+#endif
+    }
+    return false;
+}
+
+#ifndef TUI_NO_MOUSE
+/* Handle scrollbar input (mouse only) */
+static bool tui_widget_handle_scrollbar_input(tui_widget* w, tui_widget_event* e) {
+    if (!w || !e) return false;
+    
+    int* scr = &w->state.scrollbar.scroll;
+    int content = w->state.scrollbar.content_size;
+    int view = w->state.scrollbar.view_size;
+    int max_scroll = content - view;
+    if (max_scroll < 0) max_scroll = 0;
+    
+    if (e->base.type == TUI_EVENT_MOUSE) {
+        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
+            int ax, ay, aw, ah;
+            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
+            
+            if (w->state.scrollbar.vertical) {
+                float ratio = (float)(e->base.mouse_y - ay) / (float)(ah - 1);
+                *scr = (int)(ratio * (float)max_scroll + 0.5f);
+            } else {
+                float ratio = (float)(e->base.mouse_x - ax) / (float)(aw - 1);
+                *scr = (int)(ratio * (float)max_scroll + 0.5f);
+            }
+            if (*scr < 0) *scr = 0;
+            if (*scr > max_scroll) *scr = max_scroll;
+            w->state.scrollbar.dragging = true;
+            return true;
+        } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_UP) {
+            *scr -= 3;
+            if (*scr < 0) *scr = 0;
             return true;
         } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_DOWN) {
-            int max_scroll = count - visible;
-            if (max_scroll < 0) max_scroll = 0;
-            if (*scr < max_scroll) (*scr)++;
+            *scr += 3;
+            if (*scr > max_scroll) *scr = max_scroll;
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#ifndef TUI_NO_TEXTAREA
+
+/* ============================================================================
+ * Textarea Editing Primitives
+ * ============================================================================ */
+
+/* Buffer size of each line (including the terminator) */
+static int tui_textarea_line_size(tui_widget* w) {
+    return w->state.textarea.max_line_len > 0 ? w->state.textarea.max_line_len : 256;
+}
+
+/* Byte length and display width of one line. An entry is re-measured when
+ * invalidated by an edit or when the app swapped in a different pointer. */
+typedef struct {
+    const char* text;       /* Line pointer the entry was measured from */
+    int len;
+    int width;
+    bool valid;
+} tui_line_info;
+
+struct tui_line_cache {
+    tui_line_info* lines;
+    int count;
+    int capacity;
+    char** source;          /* Line array the cache mirrors */
+};
+
+static void tui_line_cache_free(tui_line_cache* lc) {
+    if (!lc) return;
+    free(lc->lines);
+    free(lc);
+}
+
+static bool tui_line_cache_reserve(tui_line_cache* lc, int count) {
+    if (count <= lc->capacity) return true;
+    int cap = lc->capacity ? lc->capacity : 64;
+    while (cap < count) cap *= 2;
+    tui_line_info* lines = (tui_line_info*)realloc(lc->lines, (size_t)cap * sizeof(tui_line_info));
+    if (!lines) return false;
+    lc->lines = lines;
+    lc->capacity = cap;
+    return true;
+}
+
+/* Start over, e.g. when the app replaced the line array or its count */
+static bool tui_line_cache_reset(tui_widget* w) {
+    tui_line_cache* lc = w->state.textarea.line_info;
+    int count = w->state.textarea.line_count;
+    if (!lc) {
+        lc = (tui_line_cache*)calloc(1, sizeof(tui_line_cache));
+        if (!lc) return false;
+        w->state.textarea.line_info = lc;
+    }
+    if (!tui_line_cache_reserve(lc, count)) return false;
+    if (count > 0) memset(lc->lines, 0, (size_t)count * sizeof(tui_line_info));
+    lc->count = count;
+    lc->source = w->state.textarea.lines;
+    return true;
+}
+
+static void tui_line_measure(tui_line_info* info, const char* line) {
+    int len = 0;
+    int width = 0;
+    if (line) {
+        /* ASCII prefix is one cell per byte; decode only past it */
+        while (line[len] && !((uint8_t)line[len] & 0x80)) len++;
+        width = len;
+        if (line[len]) {
+            int total = len + (int)strlen(line + len);
+            while (len < total) {
+                uint32_t cp;
+                len += tui_utf8_decode((const uint8_t*)line + len, total - len, &cp);
+                width += tui_char_width(cp);
+            }
+        }
+    }
+    info->text = line;
+    info->len = len;
+    info->width = width;
+    info->valid = true;
+}
+
+static tui_line_info* tui_textarea_line_info(tui_widget* w, int row) {
+    tui_line_cache* lc = w->state.textarea.line_info;
+    if (!lc || lc->source != w->state.textarea.lines || lc->count != w->state.textarea.line_count) {
+        if (!tui_line_cache_reset(w)) return NULL;
+        lc = w->state.textarea.line_info;
+    }
+    tui_line_info* info = &lc->lines[row];
+    const char* line = w->state.textarea.lines[row];
+    if (!info->valid || info->text != line) tui_line_measure(info, line);
+    return info;
+}
+
+static int tui_textarea_line_len(tui_widget* w, int row) {
+    tui_line_info* info = tui_textarea_line_info(w, row);
+    if (info) return info->len;
+    const char* line = w->state.textarea.lines[row];
+    return line ? (int)strlen(line) : 0;
+}
+
+/* Mirror a line-array edit: shift entries once, invalidate the changed ones */
+static void tui_line_cache_splice(tui_widget* w, int row, int removed, int inserted) {
+    tui_line_cache* lc = w->state.textarea.line_info;
+    int count = w->state.textarea.line_count;
+    if (!lc || lc->source != w->state.textarea.lines) return;
+    if (lc->count != count + removed - inserted || row >= lc->count || !tui_line_cache_reserve(lc, count)) {
+        lc->count = -1;
+        return;
+    }
+    
+    if (removed != inserted) {
+        memmove(&lc->lines[row + 1 + inserted], &lc->lines[row + 1 + removed],
+                (size_t)(lc->count - row - 1 - removed) * sizeof(tui_line_info));
+    }
+    for (int i = row; i <= row + inserted; i++) {
+        lc->lines[i].valid = false;
+    }
+    lc->count = count;
+}
+
+static void tui_textarea_visual_pos(tui_widget* w, int row, int col, int* vrow, int* vcol);
+static void tui_wrap_splice(tui_widget* w, int row, int removed, int inserted);
+
+/* Keep the cursor row inside the visible range */
+static void tui_textarea_scroll_to_cursor(tui_widget* w) {
+    int visible_rows = w->height - (w->has_border ? 2 : 0);
+    int row, col;
+    int* scroll_row = &w->state.textarea.scroll_row;
+    tui_textarea_visual_pos(w, w->state.textarea.cursor_row, w->state.textarea.cursor_col, &row, &col);
+    
+    if (row < *scroll_row) *scroll_row = row;
+    if (visible_rows > 0 && row >= *scroll_row + visible_rows) *scroll_row = row - visible_rows + 1;
+}
+
+static void tui_highlight_splice(tui_widget* w, int row, int removed, int inserted);
+
+/* Called after every edit: line `row` changed, then `removed` lines after it
+ * were dropped and `inserted` new lines were placed after it */
+static void tui_textarea_lines_changed(tui_widget* w, int row, int removed, int inserted) {
+    w->state.textarea.sel_start_row = -1;
+    tui_line_cache_splice(w, row, removed, inserted);
+    tui_highlight_splice(w, row, removed, inserted);
+    tui_wrap_splice(w, row, removed, inserted);
+}
+
+/* Walk len bytes forward from (row, col), counting each line break as one byte */
+static bool tui_textarea_locate(tui_widget* w, int row, int col, int len, int* end_row, int* end_col) {
+    int remaining = len;
+    
+    while (true) {
+        int avail = tui_textarea_line_len(w, row) - col;
+        if (remaining <= avail) {
+            *end_row = row;
+            *end_col = col + remaining;
             return true;
         }
+        if (row + 1 >= w->state.textarea.line_count) return false;
+        remaining -= avail + 1;
+        row++;
+        col = 0;
+    }
+}
+
+/* Copy len bytes starting at (row, col) into dst, with '\n' between lines */
+static void tui_textarea_extract(tui_widget* w, int row, int col, int len, char* dst) {
+    while (len > 0) {
+        const char* line = w->state.textarea.lines[row];
+        int avail = tui_textarea_line_len(w, row) - col;
+        int chunk = len < avail ? len : avail;
+        if (chunk > 0) {
+            memcpy(dst, line + col, (size_t)chunk);
+            dst += chunk;
+            len -= chunk;
+        }
+        if (len > 0) {
+            *dst++ = '\n';
+            len--;
+            row++;
+            col = 0;
+        }
+    }
+}
+
+/* Insert text at (row, col); '\n' splits lines. Nothing is modified if a line
+ * would exceed max_line_len or the line array would exceed line_capacity.
+ * On success the position just past the inserted text is returned. */
+static bool tui_textarea_insert_raw(tui_widget* w, int row, int col, const char* text, int len,
+                                    int* end_row, int* end_col) {
+    char** lines = w->state.textarea.lines;
+    int size = tui_textarea_line_size(w);
+    int cur_len = tui_textarea_line_len(w, row);
+    if (col < 0 || col > cur_len || len < 0) return false;
+    
+    /* Measure line breaks and check every resulting line fits */
+    int breaks = 0;
+    int first_seg = len;
+    int seg_start = 0;
+    const char* nl;
+    while ((nl = memchr(text + seg_start, '\n', (size_t)(len - seg_start))) != NULL) {
+        int seg_len = (int)(nl - text) - seg_start;
+        if (breaks == 0) {
+            first_seg = seg_len;
+        } else if (seg_len > size - 1) {
+            return false;
+        }
+        breaks++;
+        seg_start = (int)(nl - text) + 1;
+    }
+    int last_seg = len - seg_start;
+    int tail = cur_len - col;
+    
+    if (breaks == 0) {
+        if (cur_len + len > size - 1) return false;
+    } else {
+        if (col + first_seg > size - 1 || last_seg + tail > size - 1) return false;
+        if (w->state.textarea.line_count + breaks > w->state.textarea.line_capacity) return false;
+    }
+    
+    char* line = lines[row];
+    if (!line) {
+        line = (char*)malloc((size_t)size);
+        if (!line) return false;
+        line[0] = '\0';
+        lines[row] = line;
+    }
+    
+    if (breaks == 0) {
+        memmove(line + col + len, line + col, (size_t)tail + 1);
+        memcpy(line + col, text, (size_t)len);
+        tui_textarea_lines_changed(w, row, 0, 0);
+        *end_row = row;
+        *end_col = col + len;
+        return true;
+    }
+    
+    /* Open a gap in the line array once, then fill the new lines */
+    int count = w->state.textarea.line_count;
+    memmove(&lines[row + 1 + breaks], &lines[row + 1], (size_t)(count - row - 1) * sizeof(char*));
+    for (int i = 1; i <= breaks; i++) {
+        lines[row + i] = (char*)malloc((size_t)size);
+        if (!lines[row + i]) {
+            for (int j = 1; j < i; j++) free(lines[row + j]);
+            memmove(&lines[row + 1], &lines[row + 1 + breaks], (size_t)(count - row - 1) * sizeof(char*));
+            return false;
+        }
+    }
+    
+    /* Last new line: final segment followed by the text after the cursor */
+    char* last = lines[row + breaks];
+    memcpy(last, text + seg_start, (size_t)last_seg);
+    memcpy(last + last_seg, line + col, (size_t)tail);
+    last[last_seg + tail] = '\0';
+    
+    /* Middle lines */
+    int pos = first_seg + 1;
+    for (int i = 1; i < breaks; i++) {
+        const char* seg = text + pos;
+        int seg_len = (int)((const char*)memchr(seg, '\n', (size_t)(len - pos)) - seg);
+        memcpy(lines[row + i], seg, (size_t)seg_len);
+        lines[row + i][seg_len] = '\0';
+        pos += seg_len + 1;
+    }
+    
+    /* First line: text before the cursor followed by the first segment */
+    memcpy(line + col, text, (size_t)first_seg);
+    line[col + first_seg] = '\0';
+    
+    w->state.textarea.line_count += breaks;
+    tui_textarea_lines_changed(w, row, 0, breaks);
+    *end_row = row + breaks;
+    *end_col = last_seg;
+    return true;
+}
+
+/* Remove len bytes starting at (row, col), joining lines across removed breaks.
+ * Nothing is modified if the joined line would exceed max_line_len. */
+static bool tui_textarea_delete_raw(tui_widget* w, int row, int col, int len) {
+    char** lines = w->state.textarea.lines;
+    int end_row, end_col;
+    if (len <= 0 || !tui_textarea_locate(w, row, col, len, &end_row, &end_col)) return false;
+    
+    char* line = lines[row];
+    if (end_row == row) {
+        int cur_len = tui_textarea_line_len(w, row);
+        memmove(line + col, line + col + len, (size_t)(cur_len - col - len) + 1);
+        tui_textarea_lines_changed(w, row, 0, 0);
+        return true;
+    }
+    
+    const char* last = lines[end_row];
+    int keep = tui_textarea_line_len(w, end_row) - end_col;
+    if (col + keep > tui_textarea_line_size(w) - 1) return false;
+    
+    if (!line) {
+        line = (char*)malloc((size_t)tui_textarea_line_size(w));
+        if (!line) return false;
+        lines[row] = line;
+    }
+    if (keep > 0) memcpy(line + col, last + end_col, (size_t)keep);
+    line[col + keep] = '\0';
+    
+    /* Drop the joined lines and close the gap once */
+    int count = w->state.textarea.line_count;
+    for (int i = row + 1; i <= end_row; i++) free(lines[i]);
+    memmove(&lines[row + 1], &lines[end_row + 1], (size_t)(count - end_row - 1) * sizeof(char*));
+    w->state.textarea.line_count -= end_row - row;
+    tui_textarea_lines_changed(w, row, end_row - row, 0);
+    return true;
+}
+
+/* ============================================================================
+ * Textarea Undo Log
+ * ============================================================================ */
+
+/* One edit. The text lives in the log's byte arena, so an operation costs its
+ * own size regardless of document size. Positions are (row, byte column). */
+typedef struct {
+    int row;
+    int col;
+    int cursor_row;         /* Cursor before the edit */
+    int cursor_col;
+    int text_pos;           /* Offset into the text arena */
+    int text_len;
+    uint8_t kind;           /* TUI_UNDO_INSERT or TUI_UNDO_DELETE */
+} tui_undo_op;
+
+#define TUI_UNDO_INSERT 0
+#define TUI_UNDO_DELETE 1
+
+/* Ops [op_first, op_count) can be undone, [op_count, op_end) redone.
+ * Evicted ops and their text are dropped from the front and compacted lazily. */
+struct tui_undo_log {
+    tui_undo_op* ops;
+    int op_first;
+    int op_count;
+    int op_end;
+    int op_capacity;
+    char* text;
+    int text_first;
+    int text_end;
+    int text_capacity;
+    int limit;
+    bool coalesce;          /* Next keystroke may extend the last op */
+};
+
+static void tui_undo_log_free(tui_undo_log* log) {
+    if (!log) return;
+    free(log->ops);
+    free(log->text);
+    free(log);
+}
+
+static void tui_undo_log_reset(tui_undo_log* log) {
+    log->op_first = log->op_count = log->op_end = 0;
+    log->text_first = log->text_end = 0;
+    log->coalesce = false;
+}
+
+static tui_undo_log* tui_undo_log_get(tui_widget* w) {
+    if (!w->state.textarea.undo) {
+        tui_undo_log* log = (tui_undo_log*)calloc(1, sizeof(tui_undo_log));
+        if (!log) return NULL;
+        log->limit = TUI_UNDO_DEFAULT_LIMIT;
+        w->state.textarea.undo = log;
+    }
+    return w->state.textarea.undo;
+}
+
+/* Stop the next keystroke from merging into the last op */
+static void tui_undo_break(tui_widget* w) {
+    if (w->state.textarea.undo) w->state.textarea.undo->coalesce = false;
+}
+
+static int tui_undo_log_usage(tui_undo_log* log) {
+    return (log->text_end - log->text_first) + (log->op_end - log->op_first) * (int)sizeof(tui_undo_op);
+}
+
+/* Make room for one more op record and extra_text bytes at the arena tail */
+static bool tui_undo_reserve(tui_undo_log* log, int extra_ops, int extra_text) {
+    if (log->op_end + extra_ops > log->op_capacity) {
+        if (log->op_first > 0) {
+            int live = log->op_end - log->op_first;
+            memmove(log->ops, log->ops + log->op_first, (size_t)live * sizeof(tui_undo_op));
+            log->op_count -= log->op_first;
+            log->op_end = live;
+            log->op_first = 0;
+        }
+        if (log->op_end + extra_ops > log->op_capacity) {
+            int cap = log->op_capacity ? log->op_capacity * 2 : 64;
+            tui_undo_op* ops = (tui_undo_op*)realloc(log->ops, (size_t)cap * sizeof(tui_undo_op));
+            if (!ops) return false;
+            log->ops = ops;
+            log->op_capacity = cap;
+        }
+    }
+    
+    if (log->text_end + extra_text > log->text_capacity) {
+        if (log->text_first > 0) {
+            int live = log->text_end - log->text_first;
+            memmove(log->text, log->text + log->text_first, (size_t)live);
+            for (int i = log->op_first; i < log->op_end; i++) {
+                log->ops[i].text_pos -= log->text_first;
+            }
+            log->text_end = live;
+            log->text_first = 0;
+        }
+        if (log->text_end + extra_text > log->text_capacity) {
+            int cap = log->text_capacity ? log->text_capacity : 1024;
+            while (cap < log->text_end + extra_text) cap *= 2;
+            char* text = (char*)realloc(log->text, (size_t)cap);
+            if (!text) return false;
+            log->text = text;
+            log->text_capacity = cap;
+        }
+    }
+    return true;
+}
+
+/* Evict the oldest ops until the log fits its byte budget */
+static void tui_undo_evict(tui_undo_log* log) {
+    while (tui_undo_log_usage(log) > log->limit && log->op_first < log->op_count) {
+        log->op_first++;
+        log->text_first = (log->op_first < log->op_end) ? log->ops[log->op_first].text_pos
+                                                        : log->text_end;
+    }
+}
+
+/* Append a new op with len bytes of arena space; discards anything redoable.
+ * Returns NULL (and forgets all history) if the op alone exceeds the budget. */
+static tui_undo_op* tui_undo_push(tui_undo_log* log, uint8_t kind, int row, int col,
+                                  int cursor_row, int cursor_col, int len) {
+    log->op_end = log->op_count;
+    log->text_end = (log->op_count > log->op_first)
+                  ? log->ops[log->op_count - 1].text_pos + log->ops[log->op_count - 1].text_len
+                  : log->text_first;
+    log->coalesce = false;
+    
+    if (len + (int)sizeof(tui_undo_op) > log->limit || !tui_undo_reserve(log, 1, len)) {
+        tui_undo_log_reset(log);
+        return NULL;
+    }
+    
+    tui_undo_op* op = &log->ops[log->op_end];
+    op->kind = kind;
+    op->row = row;
+    op->col = col;
+    op->cursor_row = cursor_row;
+    op->cursor_col = cursor_col;
+    op->text_pos = log->text_end;
+    op->text_len = len;
+    log->text_end += len;
+    log->op_count = ++log->op_end;
+    return op;
+}
+
+/* Last op, if the next keystroke may still be merged into it */
+static tui_undo_op* tui_undo_coalesce_target(tui_undo_log* log, uint8_t kind) {
+    if (!log->coalesce || log->op_count != log->op_end || log->op_count <= log->op_first) return NULL;
+    tui_undo_op* op = &log->ops[log->op_count - 1];
+    if (op->kind != kind || op->text_len >= TUI_UNDO_COALESCE_MAX) return NULL;
+    return op;
+}
+
+static void tui_undo_record_insert(tui_widget* w, int row, int col, const char* text, int len,
+                                   int cursor_row, int cursor_col) {
+    tui_undo_log* log = tui_undo_log_get(w);
+    if (!log) return;
+    
+    /* Typing runs extend the previous insert; a new word starts a new step */
+    bool single = (len == 1 && text[0] != '\n');
+    tui_undo_op* last = single ? tui_undo_coalesce_target(log, TUI_UNDO_INSERT) : NULL;
+    if (last && last->row == row && last->col + last->text_len == col &&
+        !(text[0] != ' ' && log->text[last->text_pos + last->text_len - 1] == ' ')) {
+        if (tui_undo_reserve(log, 0, 1)) {
+            last = &log->ops[log->op_count - 1];
+            log->text[log->text_end++] = text[0];
+            last->text_len++;
+            tui_undo_evict(log);
+            return;
+        }
+    }
+    
+    tui_undo_op* op = tui_undo_push(log, TUI_UNDO_INSERT, row, col, cursor_row, cursor_col, len);
+    if (!op) return;
+    memcpy(log->text + op->text_pos, text, (size_t)len);
+    log->coalesce = single;
+    tui_undo_evict(log);
+}
+
+/* Record len bytes at (row, col) before they are deleted */
+static void tui_undo_record_delete(tui_widget* w, int row, int col, int len,
+                                   int cursor_row, int cursor_col) {
+    tui_undo_log* log = tui_undo_log_get(w);
+    if (!log) return;
+    
+    /* Backspace runs prepend to the previous delete, Delete-key runs append */
+    bool single = (len == 1 && col < tui_textarea_line_len(w, row));
+    tui_undo_op* last = single ? tui_undo_coalesce_target(log, TUI_UNDO_DELETE) : NULL;
+    if (last && last->row == row && (last->col == col + 1 || last->col == col)) {
+        bool backspace = (last->col == col + 1);
+        if (tui_undo_reserve(log, 0, 1)) {
+            last = &log->ops[log->op_count - 1];
+            char* text = log->text + last->text_pos;
+            if (backspace) {
+                memmove(text + 1, text, (size_t)last->text_len);
+                text[0] = w->state.textarea.lines[row][col];
+                last->col = col;
+            } else {
+                text[last->text_len] = w->state.textarea.lines[row][col];
+            }
+            last->text_len++;
+            log->text_end++;
+            tui_undo_evict(log);
+            return;
+        }
+    }
+    
+    tui_undo_op* op = tui_undo_push(log, TUI_UNDO_DELETE, row, col, cursor_row, cursor_col, len);
+    if (!op) return;
+    tui_textarea_extract(w, row, col, len, log->text + op->text_pos);
+    log->coalesce = single;
+    tui_undo_evict(log);
+}
+
+/* Drop the op just pushed for an edit that then failed */
+static void tui_undo_unrecord(tui_widget* w) {
+    tui_undo_log* log = w->state.textarea.undo;
+    if (!log || log->op_count <= log->op_first) return;
+    log->op_count = --log->op_end;
+    log->text_end = log->ops[log->op_end].text_pos;
+    log->coalesce = false;
+}
+
+/* Insert at (row, col) and move the cursor past the text, recording undo */
+static bool tui_textarea_edit_insert(tui_widget* w, int row, int col, const char* text, int len) {
+    int end_row, end_col;
+    int cursor_row = w->state.textarea.cursor_row;
+    int cursor_col = w->state.textarea.cursor_col;
+    if (len <= 0 || !tui_textarea_insert_raw(w, row, col, text, len, &end_row, &end_col)) return false;
+    
+    tui_undo_record_insert(w, row, col, text, len, cursor_row, cursor_col);
+    w->state.textarea.cursor_row = end_row;
+    w->state.textarea.cursor_col = end_col;
+    tui_textarea_scroll_to_cursor(w);
+    return true;
+}
+
+/* Delete len bytes at (row, col) and move the cursor there, recording undo */
+static bool tui_textarea_edit_delete(tui_widget* w, int row, int col, int len) {
+    int end_row, end_col;
+    if (len <= 0 || !tui_textarea_locate(w, row, col, len, &end_row, &end_col)) return false;
+    
+    tui_undo_record_delete(w, row, col, len, w->state.textarea.cursor_row, w->state.textarea.cursor_col);
+    if (!tui_textarea_delete_raw(w, row, col, len)) {
+        tui_undo_unrecord(w);
+        return false;
+    }
+    w->state.textarea.cursor_row = row;
+    w->state.textarea.cursor_col = col;
+    tui_textarea_scroll_to_cursor(w);
+    return true;
+}
+
+bool tui_textarea_insert(tui_widget* w, int row, int col, const char* bytes, int len) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.lines || !bytes) return false;
+    if (row < 0 || row >= w->state.textarea.line_count || len < 0) return false;
+    if (len == 0) return true;
+    
+    int* cursor_row = &w->state.textarea.cursor_row;
+    int* cursor_col = &w->state.textarea.cursor_col;
+    int end_row, end_col;
+    int old_row = *cursor_row;
+    int old_col = *cursor_col;
+    if (!tui_textarea_insert_raw(w, row, col, bytes, len, &end_row, &end_col)) return false;
+    
+    tui_undo_break(w);
+    tui_undo_record_insert(w, row, col, bytes, len, old_row, old_col);
+    tui_undo_break(w);
+    
+    if (old_row == row && old_col >= col) {
+        *cursor_row = end_row;
+        *cursor_col = end_col + (old_col - col);
+    } else if (old_row > row) {
+        *cursor_row += end_row - row;
+    }
+    tui_textarea_scroll_to_cursor(w);
+    return true;
+}
+
+bool tui_textarea_undo(tui_widget* w) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.lines) return false;
+    tui_undo_log* log = w->state.textarea.undo;
+    if (!log || log->op_count <= log->op_first) return false;
+    
+    tui_undo_op* op = &log->ops[log->op_count - 1];
+    bool ok;
+    if (op->kind == TUI_UNDO_INSERT) {
+        ok = tui_textarea_delete_raw(w, op->row, op->col, op->text_len);
+    } else {
+        int end_row, end_col;
+        ok = tui_textarea_insert_raw(w, op->row, op->col, log->text + op->text_pos, op->text_len,
+                                     &end_row, &end_col);
+    }
+    if (!ok) {
+        /* Lines no longer match the history (changed behind our back) */
+        tui_undo_log_reset(log);
+        return false;
+    }
+    
+    log->op_count--;
+    log->coalesce = false;
+    w->state.textarea.cursor_row = op->cursor_row;
+    w->state.textarea.cursor_col = op->cursor_col;
+    tui_textarea_scroll_to_cursor(w);
+    return true;
+}
+
+bool tui_textarea_redo(tui_widget* w) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.lines) return false;
+    tui_undo_log* log = w->state.textarea.undo;
+    if (!log || log->op_count >= log->op_end) return false;
+    
+    tui_undo_op* op = &log->ops[log->op_count];
+    int end_row = op->row;
+    int end_col = op->col;
+    bool ok;
+    if (op->kind == TUI_UNDO_INSERT) {
+        ok = tui_textarea_insert_raw(w, op->row, op->col, log->text + op->text_pos, op->text_len,
+                                     &end_row, &end_col);
+    } else {
+        ok = tui_textarea_delete_raw(w, op->row, op->col, op->text_len);
+    }
+    if (!ok) {
+        tui_undo_log_reset(log);
+        return false;
+    }
+    
+    log->op_count++;
+    log->coalesce = false;
+    w->state.textarea.cursor_row = end_row;
+    w->state.textarea.cursor_col = end_col;
+    tui_textarea_scroll_to_cursor(w);
+    return true;
+}
+
+void tui_textarea_set_undo_limit(tui_widget* w, int max_bytes) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA) return;
+    tui_undo_log* log = tui_undo_log_get(w);
+    if (!log) return;
+    log->limit = max_bytes > 0 ? max_bytes : TUI_UNDO_DEFAULT_LIMIT;
+    tui_undo_evict(log);
+}
+
+void tui_textarea_clear_undo(tui_widget* w) {
+    if (w && w->type == TUI_WIDGET_TEXTAREA && w->state.textarea.undo) {
+        tui_undo_log_reset(w->state.textarea.undo);
+    }
+}
+
+/* ============================================================================
+ * Textarea Syntax Highlighting
+ * ============================================================================ */
+
+/* Cached lexer result for one line */
+typedef struct {
+    int state_in;           /* Lexer state the spans were computed from */
+    int state_out;
+    tui_text_span* spans;
+    int span_count;
+    int span_capacity;
+    bool valid;             /* Spans match the current line text */
+} tui_highlight_line;
+
+/* Lines before `frontier` are valid and chained (each state_in equals the
+ * previous state_out). Lines at or past it are re-lexed on demand, but only
+ * while their state_in disagrees, so an edit stops once the states converge. */
+struct tui_highlight_cache {
+    tui_highlight_fn fn;
+    void* userdata;
+    tui_highlight_line* lines;
+    int count;
+    int capacity;
+    int frontier;
+};
+
+static void tui_highlight_cache_free(tui_highlight_cache* hl) {
+    if (!hl) return;
+    for (int i = 0; i < hl->count; i++) free(hl->lines[i].spans);
+    free(hl->lines);
+    free(hl);
+}
+
+static bool tui_highlight_reserve(tui_highlight_cache* hl, int count) {
+    if (count <= hl->capacity) return true;
+    int cap = hl->capacity ? hl->capacity : 64;
+    while (cap < count) cap *= 2;
+    tui_highlight_line* lines = (tui_highlight_line*)realloc(hl->lines, (size_t)cap * sizeof(tui_highlight_line));
+    if (!lines) return false;
+    hl->lines = lines;
+    hl->capacity = cap;
+    return true;
+}
+
+/* Discard every cached line (used when lines were replaced wholesale) */
+static void tui_highlight_reset(tui_highlight_cache* hl, int count) {
+    for (int i = count; i < hl->count; i++) {
+        free(hl->lines[i].spans);
+    }
+    if (count > hl->count) {
+        if (!tui_highlight_reserve(hl, count)) count = hl->count;
+        memset(hl->lines + hl->count, 0, (size_t)(count - hl->count) * sizeof(tui_highlight_line));
+    }
+    hl->count = count;
+    for (int i = 0; i < count; i++) {
+        hl->lines[i].valid = false;
+    }
+    hl->frontier = 0;
+}
+
+/* Mirror a line-array edit in the cache: shift once, invalidate what changed */
+static void tui_highlight_splice(tui_widget* w, int row, int removed, int inserted) {
+    tui_highlight_cache* hl = w->state.textarea.highlight;
+    if (!hl) return;
+    
+    /* Out of sync with the line array (edited directly): start over */
+    if (hl->count != w->state.textarea.line_count + removed - inserted || row >= hl->count) {
+        tui_highlight_reset(hl, w->state.textarea.line_count);
+        return;
+    }
+    
+    int count = hl->count;
+    if (removed > 0) {
+        for (int i = row + 1; i <= row + removed; i++) free(hl->lines[i].spans);
+        memmove(&hl->lines[row + 1], &hl->lines[row + 1 + removed],
+                (size_t)(count - row - 1 - removed) * sizeof(tui_highlight_line));
+        count -= removed;
+    }
+    if (inserted > 0) {
+        if (!tui_highlight_reserve(hl, count + inserted)) {
+            hl->count = count;
+            tui_highlight_reset(hl, w->state.textarea.line_count);
+            return;
+        }
+        memmove(&hl->lines[row + 1 + inserted], &hl->lines[row + 1],
+                (size_t)(count - row - 1) * sizeof(tui_highlight_line));
+        memset(&hl->lines[row + 1], 0, (size_t)inserted * sizeof(tui_highlight_line));
+        count += inserted;
+    }
+    hl->count = count;
+    hl->lines[row].valid = false;
+    if (row < hl->frontier) hl->frontier = row;
+}
+
+/* Lex lines up to `last` (inclusive), resuming from the frontier */
+static void tui_highlight_update(tui_widget* w, int last) {
+    tui_highlight_cache* hl = w->state.textarea.highlight;
+    int line_count = w->state.textarea.line_count;
+    if (hl->count != line_count) tui_highlight_reset(hl, line_count);
+    if (hl->count != line_count) return;
+    if (last >= line_count) last = line_count - 1;
+    
+    tui_text_span spans[TUI_HIGHLIGHT_MAX_SPANS];
+    int state = hl->frontier > 0 ? hl->lines[hl->frontier - 1].state_out : 0;
+    
+    for (int i = hl->frontier; i <= last; i++) {
+        tui_highlight_line* rec = &hl->lines[i];
+        if (!rec->valid || rec->state_in != state) {
+            const char* line = w->state.textarea.lines[i] ? w->state.textarea.lines[i] : "";
+            int span_count = 0;
+            rec->state_out = hl->fn(line, tui_textarea_line_len(w, i), state, spans, TUI_HIGHLIGHT_MAX_SPANS,
+                                    &span_count, hl->userdata);
+            if (span_count < 0) span_count = 0;
+            if (span_count > TUI_HIGHLIGHT_MAX_SPANS) span_count = TUI_HIGHLIGHT_MAX_SPANS;
+            
+            if (span_count > rec->span_capacity) {
+                tui_text_span* grown = (tui_text_span*)realloc(rec->spans, (size_t)span_count * sizeof(tui_text_span));
+                if (!grown) span_count = rec->span_capacity;
+                else {
+                    rec->spans = grown;
+                    rec->span_capacity = span_count;
+                }
+            }
+            if (span_count > 0) memcpy(rec->spans, spans, (size_t)span_count * sizeof(tui_text_span));
+            rec->span_count = span_count;
+            rec->state_in = state;
+            rec->valid = true;
+        }
+        state = rec->state_out;
+    }
+    if (last + 1 > hl->frontier) hl->frontier = last + 1;
+}
+
+void tui_textarea_set_highlighter(tui_widget* w, tui_highlight_fn fn, void* userdata) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA) return;
+    
+    if (!fn) {
+        tui_highlight_cache_free(w->state.textarea.highlight);
+        w->state.textarea.highlight = NULL;
+        return;
+    }
+    
+    tui_highlight_cache* hl = w->state.textarea.highlight;
+    if (!hl) {
+        hl = (tui_highlight_cache*)calloc(1, sizeof(tui_highlight_cache));
+        if (!hl) return;
+        w->state.textarea.highlight = hl;
+    }
+    hl->fn = fn;
+    hl->userdata = userdata;
+    tui_highlight_reset(hl, w->state.textarea.line_count);
+}
+
+void tui_textarea_invalidate_highlight(tui_widget* w, int row, int count) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.highlight) return;
+    tui_highlight_cache* hl = w->state.textarea.highlight;
+    
+    if (hl->count != w->state.textarea.line_count) {
+        tui_highlight_reset(hl, w->state.textarea.line_count);
+        return;
+    }
+    if (row < 0) row = 0;
+    int end = (count < 0 || row + count > hl->count) ? hl->count : row + count;
+    for (int i = row; i < end; i++) hl->lines[i].valid = false;
+    if (row < hl->frontier) hl->frontier = row;
+}
+
+/* ============================================================================
+ * Textarea Soft Wrap
+ * ============================================================================ */
+
+/* Visual row count of every logical line, plus a Fenwick tree over those
+ * counts so both directions (line -> first visual row, visual row -> line)
+ * take O(log n). Editing a line updates the tree in place; adding or removing
+ * lines shifts the counts and rebuilds the tree in one linear pass. */
+struct tui_wrap_index {
+    int* rows;              /* Visual rows of each logical line */
+    int* tree;              /* Fenwick tree over rows (1-based) */
+    int count;
+    int capacity;
+    int width;              /* Width the rows were measured at (0 = stale) */
+    int total;              /* Sum of rows */
+};
+
+static void tui_wrap_index_free(tui_wrap_index* wrap) {
+    if (!wrap) return;
+    free(wrap->rows);
+    free(wrap->tree);
+    free(wrap);
+}
+
+/* Wrap width in cells (matches the draw code), or 0 when not wrapping */
+static int tui_textarea_wrap_width(tui_widget* w) {
+    if (!w->state.textarea.word_wrap) return 0;
+    int width = w->width - (w->state.textarea.line_numbers ? 5 : 0);
+    return width > 0 ? width : 0;
+}
+
+/* End of the visual row that starts at `start`: after the last space that
+ * fits, or a hard break when a single word is wider than the row */
+static int tui_wrap_segment_end(const char* line, int len, int start, int width) {
+    if (len - start <= width) return len;
+    int end = start + width;
+    for (int i = end; i > start; i--) {
+        if (line[i - 1] == ' ') return i;
+    }
+    return end;
+}
+
+static int tui_wrap_measure(tui_widget* w, int row, int width) {
+    const char* line = w->state.textarea.lines[row];
+    int len = tui_textarea_line_len(w, row);
+    int rows = 1;
+    int start = tui_wrap_segment_end(line, len, 0, width);
+    while (start < len) {
+        start = tui_wrap_segment_end(line, len, start, width);
+        rows++;
+    }
+    return rows;
+}
+
+static bool tui_wrap_reserve(tui_wrap_index* wrap, int count) {
+    if (count <= wrap->capacity) return true;
+    int cap = wrap->capacity ? wrap->capacity : 64;
+    while (cap < count) cap *= 2;
+    int* rows = (int*)realloc(wrap->rows, (size_t)cap * sizeof(int));
+    if (!rows) return false;
+    wrap->rows = rows;
+    int* tree = (int*)realloc(wrap->tree, (size_t)(cap + 1) * sizeof(int));
+    if (!tree) return false;
+    wrap->tree = tree;
+    wrap->capacity = cap;
+    return true;
+}
+
+static void tui_wrap_build_tree(tui_wrap_index* wrap) {
+    int n = wrap->count;
+    wrap->total = 0;
+    for (int i = 1; i <= n; i++) {
+        wrap->tree[i] = wrap->rows[i - 1];
+        wrap->total += wrap->rows[i - 1];
+    }
+    for (int i = 1; i <= n; i++) {
+        int parent = i + (i & -i);
+        if (parent <= n) wrap->tree[parent] += wrap->tree[i];
+    }
+}
+
+static void tui_wrap_tree_add(tui_wrap_index* wrap, int row, int delta) {
+    for (int i = row + 1; i <= wrap->count; i += i & -i) {
+        wrap->tree[i] += delta;
+    }
+    wrap->total += delta;
+}
+
+/* Visual rows above logical line `row` */
+static int tui_wrap_prefix(const tui_wrap_index* wrap, int row) {
+    int sum = 0;
+    for (int i = row; i > 0; i -= i & -i) {
+        sum += wrap->tree[i];
+    }
+    return sum;
+}
+
+/* Logical line holding visual row `vrow` (count if past the end); `sub` gets
+ * the visual row within that line */
+static int tui_wrap_find(const tui_wrap_index* wrap, int vrow, int* sub) {
+    int pos = 0;
+    int step = 1;
+    while (step * 2 <= wrap->count) step *= 2;
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= wrap->count && wrap->tree[pos + step] <= vrow) {
+            pos += step;
+            vrow -= wrap->tree[pos];
+        }
     }
-    return false;
+    *sub = vrow;
+    return pos;
 }
 
-/* Handle slider input */
-static bool tui_widget_handle_slider_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+/* Bring the index up to date. False when not wrapping (callers then treat
+ * visual rows as logical rows). Only a width change or lines edited behind
+ * the widget's back cause a full re-measure. */
+static bool tui_wrap_sync(tui_widget* w) {
+    int width = tui_textarea_wrap_width(w);
+    int count = w->state.textarea.line_count;
+    if (width <= 0 || !w->state.textarea.lines || count <= 0) return false;
     
-    float* val = &w->state.slider.value;
-    float min = w->state.slider.min;
-    float max = w->state.slider.max;
-    float step = w->state.slider.step;
-    if (step <= 0) step = (max - min) / 20.0f;
+    tui_wrap_index* wrap = w->state.textarea.wrap;
+    if (!wrap) {
+        wrap = (tui_wrap_index*)calloc(1, sizeof(tui_wrap_index));
+        if (!wrap) return false;
+        w->state.textarea.wrap = wrap;
+    }
+    if (wrap->width == width && wrap->count == count) return true;
     
-    if (e->base.type == TUI_EVENT_KEY) {
-        switch (e->base.key) {
-            case TUI_KEY_LEFT:
-            case TUI_KEY_DOWN:
-                *val -= step;
-                if (*val < min) *val = min;
-                return true;
-                
-            case TUI_KEY_RIGHT:
-            case TUI_KEY_UP:
-                *val += step;
-                if (*val > max) *val = max;
-                return true;
-                
-            case TUI_KEY_HOME:
-                *val = min;
-                return true;
-                
-            case TUI_KEY_END:
-                *val = max;
-                return true;
-                
-            default:
-                break;
-        }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            int ax, ay, aw, ah;
-            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
-            float ratio = (float)(e->base.mouse_x - ax) / (float)(aw - 1);
-            if (ratio < 0) ratio = 0;
-            if (ratio > 1) ratio = 1;
-            *val = min + ratio * (max - min);
-            w->state.slider.dragging = true;
-            return true;
-        }
+    if (!tui_wrap_reserve(wrap, count)) return false;
+    for (int i = 0; i < count; i++) {
+        wrap->rows[i] = tui_wrap_measure(w, i, width);
     }
-    return false;
+    wrap->count = count;
+    wrap->width = width;
+    tui_wrap_build_tree(wrap);
+    return true;
 }
 
-/* Handle spinner input */
-static bool tui_widget_handle_spinner_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+/* Mirror a line-array edit: re-measure only the lines that changed */
+static void tui_wrap_splice(tui_widget* w, int row, int removed, int inserted) {
+    tui_wrap_index* wrap = w->state.textarea.wrap;
+    if (!wrap || wrap->width == 0) return;
     
-    int* val = &w->state.spinner.value;
-    int min = w->state.spinner.min;
-    int max = w->state.spinner.max;
-    int step = w->state.spinner.step;
-    if (step <= 0) step = 1;
+    int count = w->state.textarea.line_count;
+    if (wrap->count != count + removed - inserted || row >= wrap->count || !tui_wrap_reserve(wrap, count)) {
+        wrap->width = 0;
+        return;
+    }
     
-    if (e->base.type == TUI_EVENT_KEY) {
-        switch (e->base.key) {
-            case TUI_KEY_LEFT:
-            case TUI_KEY_DOWN:
-                *val -= step;
-                if (*val < min) *val = min;
-                return true;
-                
-            case TUI_KEY_RIGHT:
-            case TUI_KEY_UP:
-                *val += step;
-                if (*val > max) *val = max;
-                return true;
-                
-            default:
-                break;
-        }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            int ax, ay, aw, ah;
-            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
-            /* Left third = decrement, right third = increment */
-            int rel_x = e->base.mouse_x - ax;
-            if (rel_x < aw / 3) {
-                *val -= step;
-                if (*val < min) *val = min;
-            } else if (rel_x > 2 * aw / 3) {
-                *val += step;
-                if (*val > max) *val = max;
-            }
-            return true;
-        }
+    if (removed == 0 && inserted == 0) {
+        int rows = tui_wrap_measure(w, row, wrap->width);
+        tui_wrap_tree_add(wrap, row, rows - wrap->rows[row]);
+        wrap->rows[row] = rows;
+        return;
     }
-    return false;
+    
+    memmove(&wrap->rows[row + 1 + inserted], &wrap->rows[row + 1 + removed],
+            (size_t)(wrap->count - row - 1 - removed) * sizeof(int));
+    for (int i = row; i <= row + inserted; i++) {
+        wrap->rows[i] = tui_wrap_measure(w, i, wrap->width);
+    }
+    wrap->count = count;
+    tui_wrap_build_tree(wrap);
 }
 
-/* Handle dropdown input */
-static bool tui_widget_handle_dropdown_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
-    
-    bool* open = &w->state.dropdown.open;
-    int* sel = &w->state.dropdown.selected;
-    int count = w->state.dropdown.count;
+/* Rows the text occupies on screen */
+static int tui_textarea_total_rows(tui_widget* w) {
+    return tui_wrap_sync(w) ? w->state.textarea.wrap->total : w->state.textarea.line_count;
+}
+
+/* Screen (row, column) of a logical position, relative to the text origin */
+static void tui_textarea_visual_pos(tui_widget* w, int row, int col, int* vrow, int* vcol) {
+    *vrow = row;
+    *vcol = col;
+    if (row < 0 || row >= w->state.textarea.line_count || !tui_wrap_sync(w)) return;
     
-    if (e->base.type == TUI_EVENT_KEY) {
-        if (*open) {
-            switch (e->base.key) {
-                case TUI_KEY_UP:
-                    if (*sel > 0) (*sel)--;
-                    return true;
-                case TUI_KEY_DOWN:
-                    if (*sel < count - 1) (*sel)++;
-                    return true;
-                case TUI_KEY_ENTER:
-                case TUI_KEY_SPACE:
-                    *open = false;
-                    return true;
-                case TUI_KEY_ESC:
-                    *open = false;
-                    return true;
-                default:
-                    break;
-            }
-        } else {
-            if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
-                *open = true;
-                return true;
-            }
-        }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            if (*open) {
-                int ax, ay, aw, ah;
-                tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
-                int clicked_row = e->base.mouse_y - ay - 1;
-                if (clicked_row >= 0 && clicked_row < count && clicked_row < 5) {
-                    *sel = w->state.dropdown.scroll + clicked_row;
-                    *open = false;
-                } else {
-                    *open = false;
-                }
-            } else {
-                *open = true;
-            }
-            return true;
+    tui_wrap_index* wrap = w->state.textarea.wrap;
+    const char* line = w->state.textarea.lines[row];
+    int len = tui_textarea_line_len(w, row);
+    int sub = 0;
+    int start = 0;
+    int end = tui_wrap_segment_end(line, len, 0, wrap->width);
+    while (col >= end && end < len) {
+        start = end;
+        end = tui_wrap_segment_end(line, len, start, wrap->width);
+        sub++;
+    }
+    *vrow = tui_wrap_prefix(wrap, row) + sub;
+    *vcol = col - start;
+}
+
+/* Logical position under a screen (row, column), clamped to the text */
+static void tui_textarea_logical_pos(tui_widget* w, int vrow, int vcol, int* row, int* col) {
+    int line_count = w->state.textarea.line_count;
+    int width = 0;
+    int sub = 0;
+    
+    if (tui_wrap_sync(w)) {
+        tui_wrap_index* wrap = w->state.textarea.wrap;
+        if (vrow >= wrap->total) vrow = wrap->total - 1;
+        if (vrow < 0) vrow = 0;
+        *row = tui_wrap_find(wrap, vrow, &sub);
+        width = wrap->width;
+    } else {
+        *row = vrow < 0 ? 0 : (vrow >= line_count ? line_count - 1 : vrow);
+    }
+    
+    const char* line = w->state.textarea.lines[*row];
+    int len = tui_textarea_line_len(w, *row);
+    int start = 0;
+    int end = len;
+    if (width > 0) {
+        end = tui_wrap_segment_end(line, len, 0, width);
+        for (; sub > 0; sub--) {
+            start = end;
+            end = tui_wrap_segment_end(line, len, start, width);
         }
     }
-    return false;
+    
+    /* A click past the end of a wrapped row lands on its last character */
+    int max_col = end < len ? end - 1 : len;
+    if (vcol < 0) vcol = 0;
+    *col = start + vcol < max_col ? start + vcol : max_col;
 }
 
-/* Handle tabs input */
-static bool tui_widget_handle_tabs_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+void tui_textarea_invalidate(tui_widget* w, int row, int count) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA) return;
+    tui_textarea_invalidate_highlight(w, row, count);
     
-    int* sel = &w->state.tabs.selected;
-    int count = w->state.tabs.count;
+    tui_line_cache* lc = w->state.textarea.line_info;
+    if (lc && lc->count == w->state.textarea.line_count) {
+        int first = row < 0 ? 0 : row;
+        int end = (count < 0 || first + count > lc->count) ? lc->count : first + count;
+        for (int i = first; i < end; i++) lc->lines[i].valid = false;
+    }
     
-    if (e->base.type == TUI_EVENT_KEY) {
-        switch (e->base.key) {
-            case TUI_KEY_LEFT:
-                if (*sel > 0) (*sel)--;
-                return true;
-            case TUI_KEY_RIGHT:
-                if (*sel < count - 1) (*sel)++;
-                return true;
-            default:
-                break;
-        }
-    } else if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            /* Calculate which tab was clicked */
-            int ax, ay, aw, ah;
-            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
-            int rel_x = e->base.mouse_x - ax;
-            int tab_x = 0;
-            for (int i = 0; i < count; i++) {
-                int tab_width = w->state.tabs.labels[i] ? 
-                    (int)strlen(w->state.tabs.labels[i]) + 2 : 4;
-                if (rel_x >= tab_x && rel_x < tab_x + tab_width) {
-                    *sel = i;
-                    return true;
-                }
-                tab_x += tab_width + 1; /* +1 for separator */
-            }
-        }
+    tui_wrap_index* wrap = w->state.textarea.wrap;
+    if (!wrap || wrap->width == 0) return;
+    if (wrap->count != w->state.textarea.line_count) {
+        wrap->width = 0;
+        return;
+    }
+    if (row < 0) row = 0;
+    int end = (count < 0 || row + count > wrap->count) ? wrap->count : row + count;
+    for (int i = row; i < end; i++) {
+        int rows = tui_wrap_measure(w, i, wrap->width);
+        tui_wrap_tree_add(wrap, i, rows - wrap->rows[i]);
+        wrap->rows[i] = rows;
     }
-    return false;
 }
 
-/* Handle scrollbar input */
-static bool tui_widget_handle_scrollbar_input(tui_widget* w, tui_widget_event* e) {
-    if (!w || !e) return false;
+/* Ordered selection bounds, clamped to the text; false when empty */
+static bool tui_textarea_sel_range(tui_widget* w, int* r0, int* c0, int* r1, int* c1) {
+    int line_count = w->state.textarea.line_count;
+    int ar = w->state.textarea.sel_start_row, ac = w->state.textarea.sel_start_col;
+    int hr = w->state.textarea.sel_end_row, hc = w->state.textarea.sel_end_col;
+    if (ar < 0 || !w->state.textarea.lines || line_count == 0) return false;
     
-    int* scr = &w->state.scrollbar.scroll;
-    int content = w->state.scrollbar.content_size;
-    int view = w->state.scrollbar.view_size;
-    int max_scroll = content - view;
-    if (max_scroll < 0) max_scroll = 0;
+    if (ar > hr || (ar == hr && ac > hc)) {
+        int t = ar; ar = hr; hr = t;
+        t = ac; ac = hc; hc = t;
+    }
+    if (ar >= line_count) return false;
+    if (hr >= line_count) {
+        hr = line_count - 1;
+        hc = tui_textarea_line_len(w, hr);
+    }
+    if (ac < 0) ac = 0;
+    if (ac > tui_textarea_line_len(w, ar)) ac = tui_textarea_line_len(w, ar);
+    if (hc > tui_textarea_line_len(w, hr)) hc = tui_textarea_line_len(w, hr);
+    if (ar == hr && ac >= hc) return false;
     
-    if (e->base.type == TUI_EVENT_MOUSE) {
-        if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            int ax, ay, aw, ah;
-            tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
-            
-            if (w->state.scrollbar.vertical) {
-                float ratio = (float)(e->base.mouse_y - ay) / (float)(ah - 1);
-                *scr = (int)(ratio * (float)max_scroll + 0.5f);
-            } else {
-                float ratio = (float)(e->base.mouse_x - ax) / (float)(aw - 1);
-                *scr = (int)(ratio * (float)max_scroll + 0.5f);
-            }
-            if (*scr < 0) *scr = 0;
-            if (*scr > max_scroll) *scr = max_scroll;
-            w->state.scrollbar.dragging = true;
-            return true;
-        } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_UP) {
-            *scr -= 3;
-            if (*scr < 0) *scr = 0;
-            return true;
-        } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_DOWN) {
-            *scr += 3;
-            if (*scr > max_scroll) *scr = max_scroll;
-            return true;
-        }
+    *r0 = ar; *c0 = ac; *r1 = hr; *c1 = hc;
+    return true;
+}
+
+/* Bytes between two ordered positions, counting each line break as one */
+static int tui_textarea_span_bytes(tui_widget* w, int r0, int c0, int r1, int c1) {
+    if (r0 == r1) return c1 - c0;
+    int n = tui_textarea_line_len(w, r0) - c0 + 1;
+    for (int r = r0 + 1; r < r1; r++) n += tui_textarea_line_len(w, r) + 1;
+    return n + c1;
+}
+
+/* Remove the selected text as its own undo step */
+static bool tui_textarea_delete_selection(tui_widget* w) {
+    int r0, c0, r1, c1;
+    if (!tui_textarea_sel_range(w, &r0, &c0, &r1, &c1)) return false;
+    tui_undo_break(w);
+    bool ok = tui_textarea_edit_delete(w, r0, c0, tui_textarea_span_bytes(w, r0, c0, r1, c1));
+    tui_undo_break(w);
+    w->state.textarea.sel_start_row = -1;
+    return ok;
+}
+
+void tui_textarea_select(tui_widget* w, int anchor_row, int anchor_col, int row, int col) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.lines) return;
+    int line_count = w->state.textarea.line_count;
+    if (line_count == 0) return;
+    
+    if (row < 0) row = 0;
+    if (row >= line_count) row = line_count - 1;
+    if (col < 0) col = 0;
+    if (col > tui_textarea_line_len(w, row)) col = tui_textarea_line_len(w, row);
+    
+    tui_undo_break(w);
+    w->state.textarea.sel_start_row = anchor_row < 0 ? 0 : anchor_row;
+    w->state.textarea.sel_start_col = anchor_col;
+    w->state.textarea.sel_end_row = row;
+    w->state.textarea.sel_end_col = col;
+    w->state.textarea.cursor_row = row;
+    w->state.textarea.cursor_col = col;
+    tui_textarea_scroll_to_cursor(w);
+}
+
+void tui_textarea_clear_selection(tui_widget* w) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA) return;
+    w->state.textarea.sel_start_row = -1;
+}
+
+bool tui_textarea_get_selection(tui_widget* w, int* start_row, int* start_col,
+                                int* end_row, int* end_col) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA) return false;
+    int r0, c0, r1, c1;
+    if (!tui_textarea_sel_range(w, &r0, &c0, &r1, &c1)) return false;
+    if (start_row) *start_row = r0;
+    if (start_col) *start_col = c0;
+    if (end_row) *end_row = r1;
+    if (end_col) *end_col = c1;
+    return true;
+}
+
+tui_clipboard_status tui_textarea_copy_selection(tui_context* ctx, tui_widget* w) {
+    if (!ctx || !w || w->type != TUI_WIDGET_TEXTAREA) return TUI_CLIPBOARD_INVALID;
+    int r0, c0, r1, c1;
+    if (!tui_textarea_sel_range(w, &r0, &c0, &r1, &c1)) return TUI_CLIPBOARD_OK;
+    
+    tui_clipboard_status status = tui_clipboard_begin(ctx, (size_t)tui_textarea_span_bytes(w, r0, c0, r1, c1));
+    if (status != TUI_CLIPBOARD_OK) return status;
+    for (int r = r0; r <= r1; r++) {
+        int from = (r == r0) ? c0 : 0;
+        int to = (r == r1) ? c1 : tui_textarea_line_len(w, r);
+        if (to > from) tui_clipboard_write(ctx, w->state.textarea.lines[r] + from, (size_t)(to - from));
+        if (r < r1) tui_clipboard_write(ctx, "\n", 1);
     }
-    return false;
+    return tui_clipboard_end(ctx);
+}
+
+int tui_textarea_line_width(tui_widget* w, int row) {
+    if (!w || w->type != TUI_WIDGET_TEXTAREA || !w->state.textarea.lines) return 0;
+    if (row < 0 || row >= w->state.textarea.line_count) return 0;
+    tui_line_info* info = tui_textarea_line_info(w, row);
+    return info ? info->width : 0;
 }
 
 /* Handle textarea input */
@@ -3583,7 +8481,6 @@ static bool tui_widget_handle_textarea_input(tui_widget* w, tui_widget_event* e)
     int* scroll_row = &w->state.textarea.scroll_row;
     int line_count = w->state.textarea.line_count;
     bool editable = w->state.textarea.editable;
-    int max_line_len = w->state.textarea.max_line_len > 0 ? w->state.textarea.max_line_len : 256;
     
     /* Calculate visible rows */
     int visible_rows = w->height - (w->has_border ? 2 : 0);
@@ -3591,77 +8488,136 @@ static bool tui_widget_handle_textarea_input(tui_widget* w, tui_widget_event* e)
     int visible_cols = w->width - (w->has_border ? 2 : 0) - gutter_width;
     (void)visible_cols;
     
+#ifndef TUI_NO_MOUSE
     /* Handle mouse events */
     if (e->base.type == TUI_EVENT_MOUSE) {
         int ax, ay, aw, ah;
         tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
         
         if (e->base.mouse_button == TUI_MOUSE_LEFT) {
-            /* Click to position cursor */
+            /* Click to position cursor; held-button motion also arrives as
+             * LEFT and drags the selection head */
+            tui_undo_break(w);
             int click_row = e->base.mouse_y - ay + *scroll_row;
             int click_col = e->base.mouse_x - ax - gutter_width;
             
-            if (click_row >= 0 && click_row < line_count) {
-                *row = click_row;
-                int line_len = w->state.textarea.lines[*row] ? 
-                               (int)strlen(w->state.textarea.lines[*row]) : 0;
-                *col = (click_col >= 0) ? click_col : 0;
-                if (*col > line_len) *col = line_len;
+            if (click_row >= 0 && click_row < tui_textarea_total_rows(w)) {
+                tui_textarea_logical_pos(w, click_row, click_col, row, col);
+                /* A fresh press starts over even if a release went elsewhere */
+                if (!w->state.textarea.sel_dragging || !e->base.mouse_drag) {
+                    w->state.textarea.sel_start_row = *row;
+                    w->state.textarea.sel_start_col = *col;
+                    w->state.textarea.sel_dragging = true;
+                }
+                w->state.textarea.sel_end_row = *row;
+                w->state.textarea.sel_end_col = *col;
             }
             return true;
+        } else if (e->base.mouse_button == TUI_MOUSE_RELEASE) {
+            int r0, c0, r1, c1;
+            w->state.textarea.sel_dragging = false;
+            if (!tui_textarea_sel_range(w, &r0, &c0, &r1, &c1)) w->state.textarea.sel_start_row = -1;
+            return true;
         } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_UP) {
             *scroll_row -= 3;
             if (*scroll_row < 0) *scroll_row = 0;
             return true;
         } else if (e->base.mouse_button == TUI_MOUSE_WHEEL_DOWN) {
             *scroll_row += 3;
-            int max_scroll = line_count - visible_rows;
+            int max_scroll = tui_textarea_total_rows(w) - visible_rows;
             if (max_scroll < 0) max_scroll = 0;
             if (*scroll_row > max_scroll) *scroll_row = max_scroll;
             return true;
         }
         return false;
     }
+#endif
     
     /* Only handle key events from here */
     if (e->base.type != TUI_EVENT_KEY) return false;
     
+    /* Undo / redo */
+    if (e->base.ctrl && e->base.key == TUI_KEY_CHAR) {
+        if (e->base.ch == 'a') {
+            int last = line_count - 1;
+            tui_textarea_select(w, 0, 0, last, tui_textarea_line_len(w, last));
+            return true;
+        }
+        if (!editable) return false;
+        if (e->base.ch == 'z') {
+            tui_textarea_undo(w);
+            return true;
+        }
+        if (e->base.ch == 'y') {
+            tui_textarea_redo(w);
+            return true;
+        }
+        return false;
+    }
+    
     /* Get current line */
-    char* current_line = w->state.textarea.lines[*row];
-    int current_line_len = current_line ? (int)strlen(current_line) : 0;
+    int current_line_len = tui_textarea_line_len(w, *row);
+    
+    /* Cursor movement ends the current typing run; with Shift it extends
+     * the selection from where the cursor was */
+    bool nav = false;
+    switch (e->base.key) {
+        case TUI_KEY_UP:
+        case TUI_KEY_DOWN:
+        case TUI_KEY_LEFT:
+        case TUI_KEY_RIGHT:
+        case TUI_KEY_HOME:
+        case TUI_KEY_END:
+        case TUI_KEY_PAGEUP:
+        case TUI_KEY_PAGEDOWN:
+            tui_undo_break(w);
+            nav = true;
+            if (e->base.shift && w->state.textarea.sel_start_row < 0) {
+                w->state.textarea.sel_start_row = *row;
+                w->state.textarea.sel_start_col = *col;
+            }
+            break;
+        default:
+            break;
+    }
+    
+    /* Navigation keys (with word wrap, vertical movement follows screen rows) */
+    bool wrap = tui_wrap_sync(w);
+    int vrow, vcol;
+    tui_textarea_visual_pos(w, *row, *col, &vrow, &vcol);
     
-    /* Navigation keys */
     switch (e->base.key) {
         case TUI_KEY_UP:
-            if (*row > 0) {
+            if (wrap) {
+                if (vrow > 0) tui_textarea_logical_pos(w, vrow - 1, vcol, row, col);
+            } else if (*row > 0) {
                 (*row)--;
-                int new_line_len = w->state.textarea.lines[*row] ? 
-                                   (int)strlen(w->state.textarea.lines[*row]) : 0;
+                int new_line_len = tui_textarea_line_len(w, *row);
                 if (*col > new_line_len) *col = new_line_len;
-                if (*row < *scroll_row) *scroll_row = *row;
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_DOWN:
-            if (*row < line_count - 1) {
+            if (wrap) {
+                if (vrow < tui_textarea_total_rows(w) - 1) tui_textarea_logical_pos(w, vrow + 1, vcol, row, col);
+            } else if (*row < line_count - 1) {
                 (*row)++;
-                int new_line_len = w->state.textarea.lines[*row] ? 
-                                   (int)strlen(w->state.textarea.lines[*row]) : 0;
+                int new_line_len = tui_textarea_line_len(w, *row);
                 if (*col > new_line_len) *col = new_line_len;
-                if (*row >= *scroll_row + visible_rows) *scroll_row = *row - visible_rows + 1;
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_LEFT:
             if (*col > 0) {
                 (*col)--;
             } else if (*row > 0) {
                 (*row)--;
-                *col = w->state.textarea.lines[*row] ? 
-                       (int)strlen(w->state.textarea.lines[*row]) : 0;
-                if (*row < *scroll_row) *scroll_row = *row;
+                *col = tui_textarea_line_len(w, *row);
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_RIGHT:
             if (*col < current_line_len) {
@@ -3669,9 +8625,9 @@ static bool tui_widget_handle_textarea_input(tui_widget* w, tui_widget_event* e)
             } else if (*row < line_count - 1) {
                 (*row)++;
                 *col = 0;
-                if (*row >= *scroll_row + visible_rows) *scroll_row = *row - visible_rows + 1;
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_HOME:
             if (e->base.ctrl) {
@@ -3681,159 +8637,127 @@ static bool tui_widget_handle_textarea_input(tui_widget* w, tui_widget_event* e)
             } else {
                 *col = 0;
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_END:
             if (e->base.ctrl) {
                 *row = w->state.textarea.line_count - 1;
-                *col = w->state.textarea.lines[*row] ? 
-                       (int)strlen(w->state.textarea.lines[*row]) : 0;
-                if (*row >= *scroll_row + visible_rows) *scroll_row = *row - visible_rows + 1;
+                *col = tui_textarea_line_len(w, *row);
             } else {
                 *col = current_line_len;
             }
-            return true;
+            tui_textarea_scroll_to_cursor(w);
+            break;
             
         case TUI_KEY_PAGEUP:
-            *row -= visible_rows;
-            if (*row < 0) *row = 0;
             *scroll_row -= visible_rows;
             if (*scroll_row < 0) *scroll_row = 0;
+            if (wrap) {
+                tui_textarea_logical_pos(w, vrow - visible_rows, vcol, row, col);
+                break;
+            }
+            *row -= visible_rows;
+            if (*row < 0) *row = 0;
             {
-                int new_line_len = w->state.textarea.lines[*row] ? 
-                                   (int)strlen(w->state.textarea.lines[*row]) : 0;
+                int new_line_len = tui_textarea_line_len(w, *row);
                 if (*col > new_line_len) *col = new_line_len;
             }
-            return true;
+            break;
             
         case TUI_KEY_PAGEDOWN:
-            *row += visible_rows;
-            if (*row >= w->state.textarea.line_count) *row = w->state.textarea.line_count - 1;
             *scroll_row += visible_rows;
             {
-                int max_scroll = w->state.textarea.line_count - visible_rows;
+                int max_scroll = tui_textarea_total_rows(w) - visible_rows;
                 if (max_scroll < 0) max_scroll = 0;
                 if (*scroll_row > max_scroll) *scroll_row = max_scroll;
-                int new_line_len = w->state.textarea.lines[*row] ? 
-                                   (int)strlen(w->state.textarea.lines[*row]) : 0;
+            }
+            if (wrap) {
+                tui_textarea_logical_pos(w, vrow + visible_rows, vcol, row, col);
+                break;
+            }
+            *row += visible_rows;
+            if (*row >= w->state.textarea.line_count) *row = w->state.textarea.line_count - 1;
+            {
+                int new_line_len = tui_textarea_line_len(w, *row);
                 if (*col > new_line_len) *col = new_line_len;
             }
-            return true;
+            break;
         
         default:
             break;
     }
     
+    if (nav) {
+        if (e->base.shift) {
+            w->state.textarea.sel_end_row = *row;
+            w->state.textarea.sel_end_col = *col;
+        } else {
+            w->state.textarea.sel_start_row = -1;
+        }
+        return true;
+    }
+    
     /* Editing keys (only if editable) */
     if (!editable) return false;
     
+    /* Typing replaces the selection; Backspace and Delete just remove it */
+    switch (e->base.key) {
+        case TUI_KEY_BACKSPACE:
+        case TUI_KEY_DELETE:
+            if (tui_textarea_delete_selection(w)) return true;
+            break;
+        case TUI_KEY_ENTER:
+        case TUI_KEY_TAB:
+        case TUI_KEY_SPACE:
+            tui_textarea_delete_selection(w);
+            break;
+        case TUI_KEY_CHAR:
+            if (e->base.ch >= 32) tui_textarea_delete_selection(w);
+            break;
+        default:
+            break;
+    }
+    current_line_len = tui_textarea_line_len(w, *row);
+    
     switch (e->base.key) {
         case TUI_KEY_BACKSPACE:
-            if (*col > 0 && current_line) {
+            if (*col > 0) {
                 /* Delete char before cursor */
-                memmove(current_line + *col - 1, current_line + *col, 
-                        strlen(current_line + *col) + 1);
-                (*col)--;
-            } else if (*col == 0 && *row > 0) {
+                tui_textarea_edit_delete(w, *row, *col - 1, 1);
+            } else if (*row > 0) {
                 /* Join with previous line */
-                char* prev_line = w->state.textarea.lines[*row - 1];
-                int prev_len = prev_line ? (int)strlen(prev_line) : 0;
-                int curr_len = current_line ? (int)strlen(current_line) : 0;
-                
-                if (prev_len + curr_len < max_line_len) {
-                    /* Append current line to previous */
-                    if (current_line && prev_line) {
-                        strcat(prev_line, current_line);
-                    }
-                    /* Free current line and shift remaining lines up */
-                    free(current_line);
-                    for (int i = *row; i < w->state.textarea.line_count - 1; i++) {
-                        w->state.textarea.lines[i] = w->state.textarea.lines[i + 1];
-                    }
-                    w->state.textarea.line_count--;
-                    (*row)--;
-                    *col = prev_len;
-                    if (*row < *scroll_row) *scroll_row = *row;
-                }
+                tui_undo_break(w);
+                tui_textarea_edit_delete(w, *row - 1, tui_textarea_line_len(w, *row - 1), 1);
             }
             return true;
             
         case TUI_KEY_DELETE:
-            if (current_line && *col < current_line_len) {
-                /* Delete char at cursor */
-                memmove(current_line + *col, current_line + *col + 1, 
-                        strlen(current_line + *col + 1) + 1);
-            } else if (*row < w->state.textarea.line_count - 1) {
-                /* Join with next line */
-                char* next_line = w->state.textarea.lines[*row + 1];
-                int curr_len = current_line ? (int)strlen(current_line) : 0;
-                int next_len = next_line ? (int)strlen(next_line) : 0;
-                
-                if (curr_len + next_len < max_line_len && current_line) {
-                    strcat(current_line, next_line ? next_line : "");
-                    free(next_line);
-                    for (int i = *row + 1; i < w->state.textarea.line_count - 1; i++) {
-                        w->state.textarea.lines[i] = w->state.textarea.lines[i + 1];
-                    }
-                    w->state.textarea.line_count--;
-                }
-            }
+            /* Delete char at cursor, or join with next line */
+            if (*col >= current_line_len) tui_undo_break(w);
+            tui_textarea_edit_delete(w, *row, *col, 1);
             return true;
             
         case TUI_KEY_ENTER:
             /* Split line at cursor */
-            if (w->state.textarea.line_count < w->state.textarea.line_capacity) {
-                /* Make room for new line */
-                for (int i = w->state.textarea.line_count; i > *row + 1; i--) {
-                    w->state.textarea.lines[i] = w->state.textarea.lines[i - 1];
-                }
-                
-                /* Create new line with content after cursor */
-                const char* after_cursor = current_line ? current_line + *col : "";
-                char* new_line = (char*)malloc(max_line_len);
-                if (new_line) {
-                    strncpy(new_line, after_cursor, max_line_len - 1);
-                    new_line[max_line_len - 1] = '\0';
-                    w->state.textarea.lines[*row + 1] = new_line;
-                    
-                    /* Truncate current line at cursor */
-                    if (current_line) current_line[*col] = '\0';
-                    
-                    w->state.textarea.line_count++;
-                    (*row)++;
-                    *col = 0;
-                    if (*row >= *scroll_row + visible_rows) *scroll_row = *row - visible_rows + 1;
-                }
-            }
+            tui_textarea_edit_insert(w, *row, *col, "\n", 1);
             return true;
             
         case TUI_KEY_TAB:
             /* Insert spaces for tab */
-            if (current_line && current_line_len + 4 < max_line_len) {
-                memmove(current_line + *col + 4, current_line + *col, 
-                        strlen(current_line + *col) + 1);
-                memset(current_line + *col, ' ', 4);
-                *col += 4;
-            }
+            tui_textarea_edit_insert(w, *row, *col, "    ", 4);
             return true;
             
         case TUI_KEY_SPACE:
             /* Insert space */
-            if (current_line && current_line_len < max_line_len - 1) {
-                memmove(current_line + *col + 1, current_line + *col, 
-                        strlen(current_line + *col) + 1);
-                current_line[*col] = ' ';
-                (*col)++;
-            }
+            tui_textarea_edit_insert(w, *row, *col, " ", 1);
             return true;
             
         case TUI_KEY_CHAR:
             /* Insert character */
-            if (current_line && current_line_len < max_line_len - 1 && e->base.ch >= 32) {
-                memmove(current_line + *col + 1, current_line + *col, 
-                        strlen(current_line + *col) + 1);
-                current_line[*col] = (char)e->base.ch;
-                (*col)++;
+            if (e->base.ch >= 32) {
+                char c = (char)e->base.ch;
+                tui_textarea_edit_insert(w, *row, *col, &c, 1);
             }
             return true;
             
@@ -3844,11 +8768,40 @@ static bool tui_widget_handle_textarea_input(tui_widget* w, tui_widget_event* e)
     return false;
 }
 
+#endif /* TUI_NO_TEXTAREA */
+
 /* Handle splitter input */
 static bool tui_widget_handle_splitter_input(tui_widget* w, tui_widget_event* e) {
     if (!w || !e) return false;
     
-    if (e->base.type == TUI_EVENT_MOUSE) {
+    if (e->base.type == TUI_EVENT_KEY) {
+        /* Allow keyboard adjustment with Ctrl+arrow */
+        if (e->base.ctrl) {
+            float step = 0.05f;
+            if (w->state.splitter.vertical) {
+                if (e->base.key == TUI_KEY_UP) {
+                    w->state.splitter.ratio -= step;
+                    if (w->state.splitter.ratio < 0.1f) w->state.splitter.ratio = 0.1f;
+                    return true;
+                } else if (e->base.key == TUI_KEY_DOWN) {
+                    w->state.splitter.ratio += step;
+                    if (w->state.splitter.ratio > 0.9f) w->state.splitter.ratio = 0.9f;
+                    return true;
+                }
+            } else {
+                if (e->base.key == TUI_KEY_LEFT) {
+                    w->state.splitter.ratio -= step;
+                    if (w->state.splitter.ratio < 0.1f) w->state.splitter.ratio = 0.1f;
+                    return true;
+                } else if (e->base.key == TUI_KEY_RIGHT) {
+                    w->state.splitter.ratio += step;
+                    if (w->state.splitter.ratio > 0.9f) w->state.splitter.ratio = 0.9f;
+                    return true;
+                }
+            }
+        }
+#ifndef TUI_NO_MOUSE
+    } else if (e->base.type == TUI_EVENT_MOUSE) {
         int ax, ay, aw, ah;
         tui_widget_get_absolute_bounds(w, &ax, &ay, &aw, &ah);
         
@@ -3885,32 +8838,7 @@ static bool tui_widget_handle_splitter_input(tui_widget* w, tui_widget_event* e)
             w->state.splitter.dragging = false;
             return true;
         }
-    } else if (e->base.type == TUI_EVENT_KEY) {
-        /* Allow keyboard adjustment with Ctrl+arrow */
-        if (e->base.ctrl) {
-            float step = 0.05f;
-            if (w->state.splitter.vertical) {
-                if (e->base.key == TUI_KEY_UP) {
-                    w->state.splitter.ratio -= step;
-                    if (w->state.splitter.ratio < 0.1f) w->state.splitter.ratio = 0.1f;
-                    return true;
-                } else if (e->base.key == TUI_KEY_DOWN) {
-                    w->state.splitter.ratio += step;
-                    if (w->state.splitter.ratio > 0.9f) w->state.splitter.ratio = 0.9f;
-                    return true;
-                }
-            } else {
-                if (e->base.key == TUI_KEY_LEFT) {
-                    w->state.splitter.ratio -= step;
-                    if (w->state.splitter.ratio < 0.1f) w->state.splitter.ratio = 0.1f;
-                    return true;
-                } else if (e->base.key == TUI_KEY_RIGHT) {
-                    w->state.splitter.ratio += step;
-                    if (w->state.splitter.ratio > 0.9f) w->state.splitter.ratio = 0.9f;
-                    return true;
-                }
-            }
-        }
+#endif
     }
     
     return false;
@@ -3925,10 +8853,12 @@ static bool tui_widget_handle_button_input(tui_widget* w, tui_widget_event* e) {
         if (e->base.key == TUI_KEY_ENTER || e->base.key == TUI_KEY_SPACE) {
             activate = true;
         }
+#ifndef TUI_NO_MOUSE
     } else if (e->base.type == TUI_EVENT_MOUSE) {
         if (e->base.mouse_button == TUI_MOUSE_LEFT) {
             activate = true;
         }
+#endif
     }
     
     if (activate) {
@@ -3962,18 +8892,34 @@ static bool tui_widget_handle_default_input(tui_widget* w, tui_widget_event* e)
             return tui_widget_handle_dropdown_input(w, e);
         case TUI_WIDGET_TABS:
             return tui_widget_handle_tabs_input(w, e);
+#ifndef TUI_NO_MOUSE
         case TUI_WIDGET_SCROLLBAR:
             return tui_widget_handle_scrollbar_input(w, e);
+#endif
+#ifndef TUI_NO_TEXTAREA
         case TUI_WIDGET_TEXTAREA:
             return tui_widget_handle_textarea_input(w, e);
+#endif
         case TUI_WIDGET_SPLITTER:
             return tui_widget_handle_splitter_input(w, e);
+        case TUI_WIDGET_SCROLLVIEW:
+            return tui_widget_handle_scrollview_input(w, e);
         default:
             break;
     }
     return false;
 }
 
+/* The open list of a dropdown at x, y, width lives in the overlay layer */
+static void tui_dropdown_request_list(tui_widget_manager* wm, tui_widget* w, int x, int y, int width) {
+    int count = w->state.dropdown.count;
+    if (w->state.dropdown.open && count > 0) {
+        tui_wm_open_overlay(wm, w, x, y + 1, width, count < 5 ? count : 5, 0, NULL);
+    } else {
+        tui_wm_close_overlay(wm, w);
+    }
+}
+
 /* Route event through widget tree */
 void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
     if (!wm || !event) return;
@@ -3996,9 +8942,10 @@ void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
         return;
     }
     
-    /* Determine target */
-    tui_widget* target = NULL;
+    /* Determine target: keyboard events go to the focused widget */
+    tui_widget* target = wm->focus;
     
+#ifndef TUI_NO_MOUSE
     if (event->type == TUI_EVENT_MOUSE) {
         target = tui_wm_hit_test(wm, event->mouse_x, event->mouse_y);
         wm->hover = target;
@@ -4007,10 +8954,8 @@ void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
         if (event->mouse_button == TUI_MOUSE_LEFT && target && target->focusable) {
             tui_wm_focus(wm, target);
         }
-    } else {
-        /* Keyboard events go to focused widget */
-        target = wm->focus;
     }
+#endif
     
     if (!target) {
         target = wm->root;
@@ -4019,6 +8964,8 @@ void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
     if (!target) return;
     
     we.target = target;
+    bool dropdown_open = target->type == TUI_WIDGET_DROPDOWN && target->state.dropdown.open;
+    int dropdown_sel = target->type == TUI_WIDGET_DROPDOWN ? target->state.dropdown.selected : 0;
     
     /* Build path from root to target */
     tui_widget* path[64];
@@ -4046,6 +8993,32 @@ void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
         tui_widget_call_handlers(target, &we, false); /* Bubble handlers at target */
     }
     
+    /* Wheel over a child scrolls the nearest scroll view */
+    tui_widget* changed = target;
+#ifndef TUI_NO_MOUSE
+    if (!we.consumed && !we.prevented && event->type == TUI_EVENT_MOUSE &&
+        (event->mouse_button == TUI_MOUSE_WHEEL_UP || event->mouse_button == TUI_MOUSE_WHEEL_DOWN)) {
+        for (int i = path_len - 2; i >= 0; i--) {
+            if (path[i]->type == TUI_WIDGET_SCROLLVIEW && path[i]->enabled) {
+                we.consumed = tui_widget_handle_scrollview_input(path[i], &we);
+                changed = path[i];
+                break;
+            }
+        }
+    }
+#endif
+    if (we.consumed && changed->type == TUI_WIDGET_DROPDOWN &&
+        changed->state.dropdown.selected == dropdown_sel && changed->state.dropdown.open != dropdown_open) {
+        /* Only the list opened or closed: the tree stays clean, the overlay
+         * layer draws it or puts back what it covered */
+        int ax, ay, aw, ah;
+        tui_widget_get_absolute_bounds(changed, &ax, &ay, &aw, &ah);
+        tui_dropdown_request_list(wm, changed, ax, ay, aw);
+    } else if (we.consumed) {
+        tui_widget_push_binding(changed);
+        tui_widget_invalidate(changed);
+    }
+    
     /* BUBBLE PHASE: target → root */
     we.phase = TUI_PHASE_BUBBLE;
     for (int i = path_len - 2; i >= 0 && !we.stopped; i--) {
@@ -4053,34 +9026,76 @@ void tui_wm_route_event(tui_widget_manager* wm, tui_event* event) {
     }
 }
 
-/* Draw widget recursively */
-static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
+/* Open list of a dropdown, below its button */
+static void tui_dropdown_draw_list(tui_widget* w, tui_context* ctx, int x, int y, int width) {
+    int sel = w->state.dropdown.selected;
+    const char** items = w->state.dropdown.items;
+    const tui_str* item_ids = ctx->strings ? w->state.dropdown.item_ids : NULL;
+    int count = w->state.dropdown.count;
+    int list_height = count < 5 ? count : 5;
+    
+    for (int i = 0; i < list_height; i++) {
+        int item_idx = w->state.dropdown.scroll + i;
+        if (item_idx >= count) break;
+        
+        tui_apply_style(ctx, ctx->tokens[item_idx == sel ? TUI_TOKEN_MENU_SELECTED : TUI_TOKEN_MENU]);
+        tui_fill(ctx, x, y + i, width, 1, ' ');
+        if (item_ids) {
+            tui_label_str(ctx, x + 1, y + i, item_ids[item_idx]);
+        } else if (items && items[item_idx]) {
+            tui_label(ctx, x + 1, y + i, items[item_idx]);
+        }
+    }
+}
+
+/* A widget's resting style: the token under the widget's own colors, or
+ * the disabled token */
+static inline tui_style tui_widget_rest_style(const tui_context* ctx, const tui_widget* w,
+                                              tui_style_token token) {
+    if (!w->enabled) {
+        tui_style s = ctx->tokens[TUI_TOKEN_DISABLED];
+        if (w->bg_color != TUI_COLOR_DEFAULT) s.bg = w->bg_color;
+        return s;
+    }
+    tui_style s = ctx->tokens[token];
+    if (w->fg_color != TUI_COLOR_DEFAULT) s.fg = w->fg_color;
+    if (w->bg_color != TUI_COLOR_DEFAULT) s.bg = w->bg_color;
+    return s;
+}
+
+/* Draw widget recursively; with a manager, dropdown lists go to its overlay layer */
+static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx, tui_widget_manager* wm) {
     if (!w || !w->visible) return;
     
-    int x, y, width, height;
+    if (w->binding && w->binding_version != w->binding->version) {
+        tui_widget_pull_binding(w);
+    }
+    w->dirty = false;
+    
+    int x = 0, y = 0, width = 0, height = 0;
     tui_widget_get_absolute_bounds(w, &x, &y, &width, &height);
     
-    /* Set colors */
-    uint32_t fg = w->fg_color != TUI_COLOR_DEFAULT ? w->fg_color : TUI_COLOR_WHITE;
-    uint32_t bg = w->bg_color != TUI_COLOR_DEFAULT ? w->bg_color : TUI_COLOR_DEFAULT;
+    /* Each widget starts from its own colors, and whatever it sets is
+     * dropped before its siblings and children draw */
+    tui_style base = tui_widget_rest_style(ctx, w, TUI_TOKEN_TEXT);
+    uint32_t fg = base.fg;
+    uint32_t bg = base.bg;
+    tui_push_style(ctx, base);
     
     /* Draw based on type */
     switch (w->type) {
         case TUI_WIDGET_PANEL:
             if (w->has_border) {
-                tui_set_fg(ctx, fg);
-                tui_set_bg(ctx, bg);
                 tui_box(ctx, x, y, width, height, w->border_style);
             } else if (bg != TUI_COLOR_DEFAULT) {
-                tui_set_bg(ctx, bg);
                 tui_fill(ctx, x, y, width, height, ' ');
             }
             break;
             
         case TUI_WIDGET_LABEL:
-            tui_set_fg(ctx, fg);
-            tui_set_bg(ctx, bg);
-            if (w->state.label.text) {
+            if (w->state.label.text_id && ctx->strings) {
+                tui_label_str_aligned(ctx, x, y, width, w->state.label.text_id, w->state.label.align);
+            } else if (w->state.label.text) {
                 tui_label_aligned(ctx, x, y, width, w->state.label.text, w->state.label.align);
             }
             break;
@@ -4089,20 +9104,15 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             bool focused = w->focused;
             bool pressed = w->state.button.pressed;
             if (pressed) {
-                tui_set_fg(ctx, TUI_COLOR_BLACK);
-                tui_set_bg(ctx, TUI_COLOR_CYAN);
+                tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_BUTTON_PRESSED]);
             } else if (focused) {
-                tui_set_fg(ctx, TUI_COLOR_BLACK);
-                tui_set_bg(ctx, TUI_COLOR_WHITE);
+                tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_BUTTON_FOCUSED]);
             } else {
-                tui_set_fg(ctx, fg);
-                tui_set_bg(ctx, bg != TUI_COLOR_DEFAULT ? bg : TUI_RGB(60, 60, 60));
+                tui_apply_style(ctx, tui_widget_rest_style(ctx, w, TUI_TOKEN_BUTTON));
             }
             
             /* Draw button with brackets */
-            char buf[256];
-            snprintf(buf, sizeof(buf), "[ %s ]", w->state.button.text ? w->state.button.text : "");
-            tui_label(ctx, x, y, buf);
+            tui_labelf(ctx, x, y, "[ %s ]", w->state.button.text ? w->state.button.text : "");
             w->state.button.pressed = false;  /* Reset press state */
             break;
         }
@@ -4110,13 +9120,10 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
         case TUI_WIDGET_CHECKBOX: {
             bool focused = w->focused;
             bool checked = w->state.checkbox.checked;
-            tui_set_fg(ctx, focused ? TUI_COLOR_CYAN : fg);
-            tui_set_bg(ctx, bg);
+            if (focused) tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_TOGGLE_FOCUSED].fg);
             
-            char buf[256];
-            snprintf(buf, sizeof(buf), "[%c] %s", checked ? 'x' : ' ', 
-                     w->state.checkbox.text ? w->state.checkbox.text : "");
-            tui_label(ctx, x, y, buf);
+            tui_labelf(ctx, x, y, "[%c] %s", checked ? 'x' : ' ',
+                       w->state.checkbox.text ? w->state.checkbox.text : "");
             break;
         }
         
@@ -4124,20 +9131,17 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             bool focused = w->focused;
             bool selected = w->state.radio.group_value && 
                            (*w->state.radio.group_value == w->state.radio.value);
-            tui_set_fg(ctx, focused ? TUI_COLOR_CYAN : fg);
-            tui_set_bg(ctx, bg);
+            if (focused) tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_TOGGLE_FOCUSED].fg);
             
-            char buf[256];
-            snprintf(buf, sizeof(buf), "(%c) %s", selected ? '*' : ' ', 
-                     w->state.radio.text ? w->state.radio.text : "");
-            tui_label(ctx, x, y, buf);
+            tui_labelf(ctx, x, y, "(%c) %s", selected ? '*' : ' ',
+                       w->state.radio.text ? w->state.radio.text : "");
             break;
         }
         
         case TUI_WIDGET_TEXTBOX: {
             bool focused = w->focused;
-            tui_set_fg(ctx, focused ? TUI_COLOR_WHITE : fg);
-            tui_set_bg(ctx, focused ? TUI_RGB(40, 40, 60) : TUI_RGB(30, 30, 30));
+            tui_apply_style(ctx, focused ? ctx->tokens[TUI_TOKEN_INPUT_FOCUSED]
+                                         : tui_widget_rest_style(ctx, w, TUI_TOKEN_INPUT));
             tui_fill(ctx, x, y, width, 1, ' ');
             
             if (w->state.textbox.buffer) {
@@ -4160,8 +9164,7 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
                 if (focused) {
                     int cursor_x = x + (cursor - scroll);
                     if (cursor_x >= x && cursor_x < x + width) {
-                        tui_set_bg(ctx, TUI_COLOR_WHITE);
-                        tui_set_fg(ctx, TUI_COLOR_BLACK);
+                        tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_CURSOR]);
                         uint32_t ch = (cursor < len) ? (uint32_t)(uint8_t)buf[cursor] : ' ';
                         tui_set_cell(ctx, cursor_x, y, ch);
                     }
@@ -4177,18 +9180,26 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             int count = w->state.list.count;
             int visible = w->state.list.visible > 0 ? w->state.list.visible : height;
             const char** items = w->state.list.items;
+            const tui_str* item_ids = ctx->strings ? w->state.list.item_ids : NULL;
+            
+            /* Range ends; only the visible rows are tested against them */
+            int range_first = sel, range_last = sel;
+            tui_list_get_selection(w, &range_first, &range_last);
             
             for (int i = 0; i < visible && scr + i < count; i++) {
                 bool is_sel = (scr + i == sel);
                 if (is_sel) {
-                    tui_set_fg(ctx, focused ? TUI_COLOR_BLACK : TUI_COLOR_WHITE);
-                    tui_set_bg(ctx, focused ? TUI_COLOR_CYAN : TUI_RGB(80, 80, 80));
+                    tui_apply_style(ctx, ctx->tokens[focused ? TUI_TOKEN_LIST_CURRENT
+                                                             : TUI_TOKEN_LIST_CURRENT_BLURRED]);
+                } else if (scr + i >= range_first && scr + i <= range_last) {
+                    tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_SELECTION]);
                 } else {
-                    tui_set_fg(ctx, fg);
-                    tui_set_bg(ctx, bg);
+                    tui_apply_style(ctx, base);
                 }
                 tui_fill(ctx, x, y + i, width, 1, ' ');
-                if (items && items[scr + i]) {
+                if (item_ids) {
+                    tui_label_str(ctx, x + 1, y + i, item_ids[scr + i]);
+                } else if (items && items[scr + i]) {
                     tui_label(ctx, x + 1, y + i, items[scr + i]);
                 }
             }
@@ -4205,17 +9216,15 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             
             int filled = (int)(ratio * (float)(width - 2) + 0.5f);
             
-            tui_set_fg(ctx, fg);
-            tui_set_bg(ctx, bg);
             tui_set_cell(ctx, x, y, '[');
             tui_set_cell(ctx, x + width - 1, y, ']');
             
             for (int i = 0; i < width - 2; i++) {
                 if (i < filled) {
-                    tui_set_fg(ctx, TUI_COLOR_GREEN);
+                    tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_FILL].fg);
                     tui_set_cell(ctx, x + 1 + i, y, 0x2588); /* Full block */
                 } else {
-                    tui_set_fg(ctx, TUI_RGB(60, 60, 60));
+                    tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_TRACK].fg);
                     tui_set_cell(ctx, x + 1 + i, y, 0x2591); /* Light shade */
                 }
             }
@@ -4235,10 +9244,10 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             
             for (int i = 0; i < width; i++) {
                 if (i == pos) {
-                    tui_set_fg(ctx, focused ? TUI_COLOR_CYAN : TUI_COLOR_WHITE);
+                    tui_set_fg(ctx, ctx->tokens[focused ? TUI_TOKEN_THUMB_FOCUSED : TUI_TOKEN_THUMB].fg);
                     tui_set_cell(ctx, x + i, y, 0x25CF); /* Filled circle */
                 } else {
-                    tui_set_fg(ctx, TUI_RGB(60, 60, 60));
+                    tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_TRACK].fg);
                     tui_set_cell(ctx, x + i, y, 0x2500); /* Horizontal line */
                 }
             }
@@ -4250,26 +9259,29 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             int val = w->state.spinner.value;
             
             /* [-] value [+] */
-            tui_set_fg(ctx, focused ? TUI_COLOR_WHITE : TUI_RGB(150, 150, 150));
-            tui_set_bg(ctx, TUI_RGB(50, 50, 50));
+            tui_style spin_button = ctx->tokens[focused ? TUI_TOKEN_SPIN_BUTTON_FOCUSED
+                                                        : TUI_TOKEN_SPIN_BUTTON];
+            tui_apply_style(ctx, spin_button);
             tui_set_cell(ctx, x, y, '[');
             tui_set_cell(ctx, x + 1, y, '-');
             tui_set_cell(ctx, x + 2, y, ']');
             
-            tui_set_fg(ctx, focused ? TUI_COLOR_BLACK : fg);
-            tui_set_bg(ctx, focused ? TUI_COLOR_CYAN : TUI_RGB(30, 30, 30));
+            tui_apply_style(ctx, focused ? ctx->tokens[TUI_TOKEN_INPUT_FOCUSED]
+                                         : tui_widget_rest_style(ctx, w, TUI_TOKEN_INPUT));
             int val_width = width - 6;
             for (int i = 0; i < val_width; i++) {
                 tui_set_cell(ctx, x + 3 + i, y, ' ');
             }
-            char vbuf[16];
-            snprintf(vbuf, sizeof(vbuf), "%d", val);
-            int vlen = (int)strlen(vbuf);
+            char vbuf[24];
+            char* vend = vbuf + sizeof(vbuf);
+            char* vstart = tui_fmt_u64(vend, val < 0 ? (uint64_t)0 - (uint64_t)(int64_t)val : (uint64_t)val);
+            if (val < 0) *--vstart = '-';
+            int vlen = (int)(vend - vstart);
             int vx = x + 3 + (val_width - vlen) / 2;
-            tui_label(ctx, vx, y, vbuf);
+            tui_text_pen pen = {ctx, vx, vx, y};
+            tui_pen_text(&pen, vstart, vlen);
             
-            tui_set_fg(ctx, focused ? TUI_COLOR_WHITE : TUI_RGB(150, 150, 150));
-            tui_set_bg(ctx, TUI_RGB(50, 50, 50));
+            tui_apply_style(ctx, spin_button);
             tui_set_cell(ctx, x + width - 3, y, '[');
             tui_set_cell(ctx, x + width - 2, y, '+');
             tui_set_cell(ctx, x + width - 1, y, ']');
@@ -4281,38 +9293,27 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             bool open = w->state.dropdown.open;
             int sel = w->state.dropdown.selected;
             const char** items = w->state.dropdown.items;
+            const tui_str* item_ids = ctx->strings ? w->state.dropdown.item_ids : NULL;
             int count = w->state.dropdown.count;
             
             /* Main button */
-            tui_set_fg(ctx, focused ? TUI_COLOR_BLACK : fg);
-            tui_set_bg(ctx, focused ? TUI_COLOR_CYAN : TUI_RGB(50, 50, 50));
+            tui_apply_style(ctx, focused ? ctx->tokens[TUI_TOKEN_DROPDOWN_FOCUSED]
+                                         : tui_widget_rest_style(ctx, w, TUI_TOKEN_DROPDOWN));
             tui_fill(ctx, x, y, width, 1, ' ');
             
-            if (items && sel >= 0 && sel < count && items[sel]) {
+            if (item_ids && sel >= 0 && sel < count) {
+                tui_label_str(ctx, x + 1, y, item_ids[sel]);
+            } else if (items && sel >= 0 && sel < count && items[sel]) {
                 tui_label(ctx, x + 1, y, items[sel]);
             }
             tui_set_cell(ctx, x + width - 2, y, 0x25BC); /* Down arrow */
             
             /* Dropdown list */
-            if (open) {
-                int list_height = count < 5 ? count : 5;
-                tui_set_bg(ctx, TUI_RGB(40, 40, 40));
-                for (int i = 0; i < list_height; i++) {
-                    int item_idx = w->state.dropdown.scroll + i;
-                    if (item_idx >= count) break;
-                    
-                    bool is_sel = (item_idx == sel);
-                    if (is_sel) {
-                        tui_set_fg(ctx, TUI_COLOR_BLACK);
-                        tui_set_bg(ctx, TUI_COLOR_WHITE);
-                    } else {
-                        tui_set_fg(ctx, TUI_COLOR_WHITE);
-                        tui_set_bg(ctx, TUI_RGB(40, 40, 40));
-                    }
-                    tui_fill(ctx, x, y + 1 + i, width, 1, ' ');
-                    if (items && items[item_idx]) {
-                        tui_label(ctx, x + 1, y + 1 + i, items[item_idx]);
-                    }
+            if (open && count > 0) {
+                if (wm) {
+                    tui_dropdown_request_list(wm, w, x, y, width);
+                } else {
+                    tui_dropdown_draw_list(w, ctx, x, y + 1, width);
                 }
             }
             break;
@@ -4328,11 +9329,10 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             for (int i = 0; i < count && cur_x < x + width; i++) {
                 bool is_sel = (i == sel);
                 if (is_sel) {
-                    tui_set_fg(ctx, focused ? TUI_COLOR_BLACK : TUI_COLOR_WHITE);
-                    tui_set_bg(ctx, focused ? TUI_COLOR_CYAN : TUI_RGB(80, 80, 80));
+                    tui_apply_style(ctx, ctx->tokens[focused ? TUI_TOKEN_TAB_ACTIVE
+                                                             : TUI_TOKEN_TAB_ACTIVE_BLURRED]);
                 } else {
-                    tui_set_fg(ctx, TUI_RGB(150, 150, 150));
-                    tui_set_bg(ctx, TUI_RGB(40, 40, 40));
+                    tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_TAB]);
                 }
                 
                 tui_set_cell(ctx, cur_x, y, ' ');
@@ -4350,15 +9350,15 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
                 
                 /* Separator */
                 if (cur_x < x + width && i < count - 1) {
-                    tui_set_fg(ctx, TUI_RGB(60, 60, 60));
-                    tui_set_bg(ctx, TUI_COLOR_DEFAULT);
+                    tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_SEPARATOR].fg);
+                    tui_set_bg(ctx, bg);
                     tui_set_cell(ctx, cur_x, y, '|');
                     cur_x++;
                 }
             }
             
             /* Fill rest */
-            tui_set_bg(ctx, TUI_COLOR_DEFAULT);
+            tui_set_bg(ctx, bg);
             while (cur_x < x + width) {
                 tui_set_cell(ctx, cur_x, y, ' ');
                 cur_x++;
@@ -4375,7 +9375,7 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             int bar_len = vertical ? height : width;
             
             /* Draw track */
-            tui_set_fg(ctx, TUI_RGB(60, 60, 60));
+            tui_set_fg(ctx, ctx->tokens[TUI_TOKEN_TRACK].fg);
             for (int i = 0; i < bar_len; i++) {
                 if (vertical) {
                     tui_set_cell(ctx, x, y + i, 0x2502); /* Vertical line */
@@ -4396,7 +9396,7 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
                     thumb_pos = (scr * (bar_len - thumb_size)) / max_scroll;
                 }
                 
-                tui_set_fg(ctx, w->focused ? TUI_COLOR_CYAN : TUI_COLOR_WHITE);
+                tui_set_fg(ctx, ctx->tokens[w->focused ? TUI_TOKEN_THUMB_FOCUSED : TUI_TOKEN_THUMB].fg);
                 for (int i = 0; i < thumb_size; i++) {
                     if (vertical) {
                         tui_set_cell(ctx, x, y + thumb_pos + i, 0x2588); /* Full block */
@@ -4408,6 +9408,7 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             break;
         }
         
+#ifndef TUI_NO_TEXTAREA
         case TUI_WIDGET_TEXTAREA: {
             bool focused = w->focused;
             char** lines = w->state.textarea.lines;
@@ -4422,54 +9423,129 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             int text_x = x + gutter_width;
             int text_width = width - gutter_width;
             
+            /* With word wrap, scroll_row counts screen rows and may start
+             * part-way into a logical line */
+            tui_wrap_index* wrap = (lines && tui_wrap_sync(w)) ? w->state.textarea.wrap : NULL;
+            int line_idx = scroll_row;
+            int seg = 0;                /* Screen row within the current line */
+            int seg_start = scroll_col; /* First byte shown on this screen row */
+            if (wrap) {
+                line_idx = tui_wrap_find(wrap, scroll_row > 0 ? scroll_row : 0, &seg);
+                seg_start = 0;
+                if (line_idx < line_count && lines[line_idx]) {
+                    int len = tui_textarea_line_len(w, line_idx);
+                    for (int s = 0; s < seg; s++) {
+                        seg_start = tui_wrap_segment_end(lines[line_idx], len, seg_start, wrap->width);
+                    }
+                }
+            }
+            
+            /* Lex the visible lines (plus lookahead) that are not cached yet */
+            tui_highlight_cache* hl = w->state.textarea.highlight;
+            if (hl && lines) {
+                tui_highlight_update(w, line_idx + height - 1 + TUI_HIGHLIGHT_LOOKAHEAD);
+            }
+            
+            int sel_r0 = 0, sel_c0 = 0, sel_r1 = -1, sel_c1 = 0;
+            if (lines) tui_textarea_sel_range(w, &sel_r0, &sel_c0, &sel_r1, &sel_c1);
+            
             for (int i = 0; i < height; i++) {
-                int line_idx = scroll_row + i;
+                const char* line = (line_idx < line_count && lines) ? lines[line_idx] : NULL;
+                int line_len = line ? tui_textarea_line_len(w, line_idx) : 0;
+                int seg_end;
+                if (wrap) {
+                    seg_end = tui_wrap_segment_end(line, line_len, seg_start, wrap->width);
+                } else {
+                    seg_end = seg_start + text_width < line_len ? seg_start + text_width : line_len;
+                }
                 
                 /* Draw line number gutter */
                 if (line_numbers) {
                     if (line_idx < line_count) {
-                        tui_set_fg(ctx, TUI_RGB(100, 100, 100));
-                        tui_set_bg(ctx, TUI_RGB(30, 30, 30));
-                        char num_buf[8];
-                        snprintf(num_buf, sizeof(num_buf), "%4d", line_idx + 1);
-                        tui_label(ctx, x, y + i, num_buf);
+                        tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_GUTTER]);
+                        if (seg == 0) {
+                            tui_labelf(ctx, x, y + i, "%4d", line_idx + 1);
+                        } else {
+                            tui_fill(ctx, x, y + i, gutter_width - 1, 1, ' ');
+                        }
                         tui_set_cell(ctx, x + 4, y + i, 0x2502);
                     } else {
-                        tui_set_fg(ctx, TUI_RGB(60, 60, 60));
-                        tui_set_bg(ctx, TUI_RGB(30, 30, 30));
+                        tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_GUTTER_EMPTY]);
                         tui_fill(ctx, x, y + i, gutter_width, 1, ' ');
                     }
                 }
                 
                 /* Draw text content */
-                tui_set_fg(ctx, fg);
-                tui_set_bg(ctx, bg);
+                tui_apply_style(ctx, base);
                 tui_fill(ctx, text_x, y + i, text_width, 1, ' ');
                 
-                if (line_idx < line_count && lines && lines[line_idx]) {
-                    const char* line = lines[line_idx];
-                    int line_len = (int)strlen(line);
+                if (line) {
+                    for (int c = seg_start; c < seg_end; c++) {
+                        tui_set_cell(ctx, text_x + c - seg_start, y + i, (uint32_t)(uint8_t)line[c]);
+                    }
+                    
+                    /* Recolor highlighted spans */
+                    if (hl && line_idx < hl->count && hl->lines[line_idx].valid) {
+                        const tui_highlight_line* rec = &hl->lines[line_idx];
+                        tui_push_style(ctx, tui_get_current_style(ctx));
+                        
+                        for (int s = 0; s < rec->span_count; s++) {
+                            const tui_text_span* span = &rec->spans[s];
+                            int from = span->start > seg_start ? span->start : seg_start;
+                            int to = span->start + span->length < seg_end ? span->start + span->length : seg_end;
+                            if (from >= to) continue;
+                            
+                            tui_apply_style(ctx, tui_style_make(span->fg, span->bg != TUI_COLOR_DEFAULT ? span->bg : bg,
+                                                                span->style));
+                            for (int c = from; c < to; c++) {
+                                tui_set_cell(ctx, text_x + c - seg_start, y + i, (uint32_t)(uint8_t)line[c]);
+                            }
+                        }
+                        tui_pop_style(ctx);
+                    }
+                }
+                
+                /* Selection; a selected line break shows as one cell past the text */
+                bool last_seg = seg_end >= line_len;
+                if (line && line_idx >= sel_r0 && line_idx <= sel_r1) {
+                    int from = (line_idx == sel_r0 && sel_c0 > seg_start) ? sel_c0 : seg_start;
+                    int to = (line_idx == sel_r1) ? sel_c1 : line_len + 1;
+                    int row_end = last_seg ? line_len + 1 : seg_end;
+                    if (to > row_end) to = row_end;
+                    if (to > seg_start + text_width) to = seg_start + text_width;
                     
-                    for (int j = 0; j < text_width && scroll_col + j < line_len; j++) {
-                        tui_set_cell(ctx, text_x + j, y + i, (uint32_t)(uint8_t)line[scroll_col + j]);
+                    tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_SELECTION]);
+                    for (int c = from; c < to; c++) {
+                        uint32_t ch = (c < line_len) ? (uint32_t)(uint8_t)line[c] : ' ';
+                        tui_set_cell(ctx, text_x + c - seg_start, y + i, ch);
                     }
                 }
                 
-                /* Draw cursor */
-                if (focused && line_idx == cursor_row) {
-                    int cursor_screen_x = text_x + cursor_col - scroll_col;
-                    if (cursor_screen_x >= text_x && cursor_screen_x < text_x + text_width) {
-                        tui_set_bg(ctx, TUI_COLOR_WHITE);
-                        tui_set_fg(ctx, TUI_COLOR_BLACK);
-                        const char* line = (lines && lines[line_idx]) ? lines[line_idx] : "";
-                        int line_len = (int)strlen(line);
+                /* Draw cursor (at the end of a full wrapped row it sits on the last cell) */
+                if (focused && line_idx == cursor_row && cursor_col >= seg_start &&
+                    (cursor_col < seg_end || last_seg)) {
+                    int cursor_x = cursor_col - seg_start;
+                    if (wrap && cursor_x >= text_width) cursor_x = text_width - 1;
+                    if (cursor_x < text_width) {
+                        tui_apply_style(ctx, ctx->tokens[TUI_TOKEN_CURSOR]);
                         uint32_t ch = (cursor_col < line_len) ? (uint32_t)(uint8_t)line[cursor_col] : ' ';
-                        tui_set_cell(ctx, cursor_screen_x, y + i, ch);
+                        tui_set_cell(ctx, text_x + cursor_x, y + i, ch);
                     }
                 }
+                
+                /* Next screen row: rest of this line, or the next line */
+                if (wrap && !last_seg) {
+                    seg_start = seg_end;
+                    seg++;
+                } else {
+                    line_idx++;
+                    seg = 0;
+                    seg_start = wrap ? 0 : scroll_col;
+                }
             }
             break;
         }
+#endif
         
         case TUI_WIDGET_SPLITTER: {
             bool vertical = w->state.splitter.vertical;
@@ -4489,8 +9565,12 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             }
             
             /* Draw divider line */
-            tui_set_fg(ctx, w->state.splitter.dragging ? TUI_COLOR_CYAN : TUI_RGB(100, 100, 100));
-            tui_set_bg(ctx, bg);
+#ifndef TUI_NO_MOUSE
+            bool active = w->state.splitter.dragging;
+#else
+            bool active = false;
+#endif
+            tui_set_fg(ctx, ctx->tokens[active ? TUI_TOKEN_DIVIDER_ACTIVE : TUI_TOKEN_DIVIDER].fg);
             
             if (vertical) {
                 for (int i = 0; i < width; i++) {
@@ -4529,6 +9609,67 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
             break;
         }
         
+        case TUI_WIDGET_CHART: {
+            tui_canvas* canvas = w->state.chart.canvas;
+            if (!canvas) {
+                canvas = tui_canvas_create(width, height, TUI_CANVAS_BRAILLE);
+                if (!canvas) break;
+                w->state.chart.canvas = canvas;
+            }
+            bool resized = canvas->cols != width || canvas->rows != height;
+            if (!tui_canvas_resize(canvas, width, height)) break;
+            
+            /* Re-render only when an input changed, and then re-encode only
+             * the cells whose pixels or colors differ from the last render */
+            const tui_series* series = w->state.chart.series;
+            unsigned version = series ? series->version : 0;
+            if (resized || !w->state.chart.rendered ||
+                w->state.chart.drawn_series != series ||
+                w->state.chart.drawn_version != version ||
+                w->state.chart.drawn_window != w->state.chart.window ||
+                w->state.chart.drawn_y_min != w->state.chart.y_min ||
+                w->state.chart.drawn_y_max != w->state.chart.y_max ||
+                w->state.chart.drawn_area != w->state.chart.area ||
+                w->state.chart.drawn_fg != fg || w->state.chart.drawn_bg != bg) {
+                tui_canvas_set_color(canvas, fg);
+                tui_canvas_set_bg(canvas, bg);
+                tui_canvas_rerender_begin(canvas);
+                tui_chart_render(canvas, series, w->state.chart.window,
+                                 w->state.chart.y_min, w->state.chart.y_max, w->state.chart.area);
+                tui_canvas_rerender_end(canvas);
+                w->state.chart.rendered = true;
+                w->state.chart.drawn_series = series;
+                w->state.chart.drawn_version = version;
+                w->state.chart.drawn_window = w->state.chart.window;
+                w->state.chart.drawn_y_min = w->state.chart.y_min;
+                w->state.chart.drawn_y_max = w->state.chart.y_max;
+                w->state.chart.drawn_area = w->state.chart.area;
+                w->state.chart.drawn_fg = fg;
+                w->state.chart.drawn_bg = bg;
+            }
+            tui_canvas_draw(ctx, canvas, x, y);
+            break;
+        }
+        
+        case TUI_WIDGET_SPARKLINE:
+        case TUI_WIDGET_BARS:
+            tui_sparkline_draw(w, ctx, x, y, width, height);
+            break;
+            
+        case TUI_WIDGET_HEATMAP:
+            tui_heatmap_draw(w, ctx, x, y, width, height);
+            break;
+            
+        case TUI_WIDGET_IMAGE:
+            tui_image_draw(w, ctx, x, y, width, height);
+            break;
+            
+        case TUI_WIDGET_SCROLLVIEW:
+            if (bg != TUI_COLOR_DEFAULT) {
+                tui_fill(ctx, x, y, width, height, ' ');
+            }
+            break;
+            
         case TUI_WIDGET_CONTAINER:
         case TUI_WIDGET_CUSTOM:
         default:
@@ -4539,17 +9680,110 @@ static void tui_widget_draw_recursive(tui_widget* w, tui_context* ctx) {
     if (w->draw_fn) {
         w->draw_fn(w, ctx);
     }
+    if (w->step_fn) {
+        tui_widget_draw_steps(w, ctx, wm, x, y, width, height);
+    }
+    tui_pop_style(ctx);
     
     /* Draw children */
+    if (w->type == TUI_WIDGET_SCROLLVIEW) {
+        tui_scrollview_draw(w, ctx, wm, x, y, width, height);
+        return;
+    }
     for (int i = 0; i < w->child_count; i++) {
-        tui_widget_draw_recursive(w->children[i], ctx);
+        tui_widget_draw_recursive(w->children[i], ctx, wm);
     }
 }
 
-/* Draw all widgets */
+/* The tree, dimmed behind the top modal if there is one. Built-in overlays
+ * the tree does not request again are closed by the overlay pass. */
+static void tui_wm_draw_tree(tui_widget_manager* wm, tui_context* ctx, tui_widget* modal) {
+    for (int i = 0; i < wm->overlay_count; i++) {
+        if (!wm->overlays[i].draw_fn) wm->overlays[i].seen = false;
+    }
+    
+    if (!modal || !modal->visible || wm->modal_dim <= 0.0f) {
+        tui_widget_draw_recursive(wm->root, ctx, wm);
+    } else {
+        /* Draw the rest, dim it in place, then the modal on top */
+        modal->visible = false;
+        tui_widget_draw_recursive(wm->root, ctx, wm);
+        modal->visible = true;
+        tui_region_transform(ctx, 0, 0, ctx->width, ctx->height, TUI_TRANSFORM_FADE,
+                             TUI_COLOR_BLACK, wm->modal_dim);
+        tui_widget_draw_recursive(modal, ctx, wm);
+    }
+}
+
+/* Take back every overlay snapshot, newest first, so the back buffer shows
+ * what was beneath the overlays; false if one was stale (its area is cleared) */
+static bool tui_wm_restore_overlays(tui_widget_manager* wm, tui_context* ctx) {
+    bool ok = true;
+    while (wm->under_count > 0) {
+        int id = wm->under_ids[--wm->under_count];
+        if (tui_restore_under(ctx, id)) continue;
+        
+        tui_save_slot* slot = &ctx->save_under[id];
+        tui_cell empty = tui_make_empty_cell();
+        for (int row = slot->y; row < slot->y + slot->h; row++) {
+            for (int col = slot->x; col < slot->x + slot->w; col++) {
+                ctx->back_buffer[row * TUI_MAX_WIDTH + col] = empty;
+            }
+        }
+        ok = false;
+    }
+    return ok;
+}
+
+/* Draw all widgets. In a retained frame with a clean tree only the overlay
+ * layer is redrawn: closed and moved overlays cost their own area. */
 void tui_wm_draw(tui_widget_manager* wm, tui_context* ctx) {
     if (!wm || !wm->root || !ctx) return;
-    tui_widget_draw_recursive(wm->root, ctx);
+    
+    tui_widget* modal = wm->focus_stack_top > 0 ? wm->focus_stack[wm->focus_stack_top - 1] : NULL;
+    
+    /* A changed tree is redrawn, so what the overlays saved beneath it is stale */
+    if (wm->root->dirty || modal != wm->drawn_modal) {
+        int rx, ry, rw, rh;
+        tui_widget_get_absolute_bounds(wm->root, &rx, &ry, &rw, &rh);
+        tui_invalidate_under(ctx, rx, ry, rw, rh);
+    }
+    bool restored = tui_wm_restore_overlays(wm, ctx);
+    bool keep_tree = restored && !wm->under_missing && ctx->frame_retained && wm->drawn &&
+                     !wm->root->dirty && modal == wm->drawn_modal;
+    
+    if (!keep_tree) {
+        tui_wm_draw_tree(wm, ctx, modal);
+        wm->drawn = true;
+        wm->drawn_modal = modal;
+    }
+    
+    /* Overlay layer, bottom to top, each snapshotting what it covers. One
+     * that gets no save-under slot can't be restored, so the next frame
+     * redraws the tree instead. */
+    wm->under_missing = false;
+    for (int i = 0; i < wm->overlay_count; i++) {
+        tui_overlay* ov = &wm->overlays[i];
+        if ((!ov->draw_fn && !ov->seen) || tui_wm_behind_modal(wm, ov->owner)) {
+            tui_wm_remove_overlay(wm, i--);
+            continue;
+        }
+        int id = tui_save_under(ctx, ov->x, ov->y, ov->width, ov->height);
+        if (id >= 0) {
+            wm->under_ids[wm->under_count++] = id;
+        } else if (ov->x < ctx->width && ov->y < ctx->height &&
+                   ov->x + ov->width > 0 && ov->y + ov->height > 0) {
+            wm->under_missing = true;
+        }
+        
+        if (ov->draw_fn) {
+            ov->draw_fn(ov->owner, ctx);
+        } else if (ov->owner->type == TUI_WIDGET_DROPDOWN) {
+            tui_dropdown_draw_list(ov->owner, ctx, ov->x, ov->y, ov->width);
+        }
+    }
 }
 
+#endif /* TUI_NO_WIDGETS */
+
 #endif /* TUI_IMPLEMENTATION */